@@ -0,0 +1,263 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+/*
+ * Двунаправленный A* с оценками по ориентирам (ALT: A*, Landmarks, Triangle inequality).
+ *
+ * Предобработка выбирает несколько вершин-ориентиров и хранит расстояния от каждого ориентира
+ * до всех вершин и от всех вершин до него - O(ориентиры x V) памяти вместо таблицы V x V.
+ * По неравенству треугольника d(v, t) >= d(L, t) - d(L, v) и d(v, t) >= d(v, L) - d(t, L),
+ * максимум этих разностей - нижняя оценка расстояния до цели, согласованная с весами рёбер.
+ *
+ * Ориентиры выбираются по одному как вершины, наиболее удалённые от уже выбранных (сумма
+ * расстояний туда и обратно); вершины, недостижимые из выбранных ориентиров, берутся в первую
+ * очередь, чтобы у каждой компоненты связности был свой ориентир.
+ *
+ * Поиск идёт одновременно от начала и от цели с потенциалами p(v) = (pi_t(v) - pi_s(v)) / 2
+ * для прямого поиска и -p(v) для обратного: оба поиска работают с одними и теми же
+ * приведёнными весами, поэтому остановка - как у двунаправленного Дейкстры: когда сумма
+ * наименьших ключей очередей не меньше длины лучшего найденного пути.
+ */
+template <typename Weight>
+class AltRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    AltRouter(const Graph& graph, size_t landmark_count);
+
+    struct RouteInfo {
+        Weight weight;
+        std::vector<EdgeId> edges;
+    };
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    size_t GetLandmarkCount() const {
+        return landmarks_.size();
+    }
+
+private:
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+    static constexpr double INF = std::numeric_limits<double>::infinity();
+
+    // Расстояния Дейкстры от source по исходящим рёбрам (forward) или до source по входящим
+    std::vector<double> ComputeDistances(VertexId source, bool forward) const;
+
+    // Нижняя оценка расстояния от vertex до target; INF - target из vertex недостижима
+    double LowerBound(VertexId vertex, VertexId target) const;
+
+    const Graph& graph_;
+    std::vector<VertexId> landmarks_;
+    // Расстояния хранятся по вершинам: все ориентиры вершины v лежат подряд, начиная с v * landmarks_.size()
+    std::vector<double> from_landmark_;
+    std::vector<double> to_landmark_;
+};
+
+template <typename Weight>
+AltRouter<Weight>::AltRouter(const Graph& graph, size_t landmark_count)
+    : graph_(graph) {
+    const size_t vertex_count = graph.GetVertexCount();
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < Weight{}) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+
+    // Удалённость вершины от выбранных ориентиров; вершины без рёбер ориентирами не становятся
+    std::vector<double> remoteness(vertex_count, INF);
+    std::vector<std::vector<double>> from_distances;
+    std::vector<std::vector<double>> to_distances;
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        if (graph.GetIncidentEdges(vertex).begin() == graph.GetIncidentEdges(vertex).end()
+            && graph.GetIncomingEdges(vertex).begin() == graph.GetIncomingEdges(vertex).end()) {
+            remoteness[vertex] = -1;
+        }
+    }
+    while (landmarks_.size() < landmark_count) {
+        const auto farthest = std::max_element(remoteness.begin(), remoteness.end());
+        if (farthest == remoteness.end() || *farthest <= 0) {
+            break;
+        }
+        const VertexId landmark = static_cast<VertexId>(farthest - remoteness.begin());
+        landmarks_.push_back(landmark);
+        from_distances.push_back(ComputeDistances(landmark, true));
+        to_distances.push_back(ComputeDistances(landmark, false));
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            if (remoteness[vertex] >= 0) {
+                remoteness[vertex] = std::min(remoteness[vertex],
+                                              from_distances.back()[vertex] + to_distances.back()[vertex]);
+            }
+        }
+    }
+
+    const size_t count = landmarks_.size();
+    from_landmark_.resize(vertex_count * count);
+    to_landmark_.resize(vertex_count * count);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        for (size_t i = 0; i < count; ++i) {
+            from_landmark_[vertex * count + i] = from_distances[i][vertex];
+            to_landmark_[vertex * count + i] = to_distances[i][vertex];
+        }
+    }
+}
+
+template <typename Weight>
+std::vector<double> AltRouter<Weight>::ComputeDistances(VertexId source, bool forward) const {
+    std::vector<double> distance(graph_.GetVertexCount(), INF);
+    using Item = std::pair<double, VertexId>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<>> queue;
+    distance[source] = 0;
+    queue.push({0, source});
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > distance[vertex]) {
+            continue;
+        }
+        for (const EdgeId edge_id : forward ? graph_.GetIncidentEdges(vertex) : graph_.GetIncomingEdges(vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const VertexId next = forward ? edge.to : edge.from;
+            const double candidate = weight + static_cast<double>(edge.weight);
+            if (candidate < distance[next]) {
+                distance[next] = candidate;
+                queue.push({candidate, next});
+            }
+        }
+    }
+    return distance;
+}
+
+template <typename Weight>
+double AltRouter<Weight>::LowerBound(VertexId vertex, VertexId target) const {
+    const size_t count = landmarks_.size();
+    const double* from_vertex = from_landmark_.data() + vertex * count;
+    const double* from_target = from_landmark_.data() + target * count;
+    const double* to_vertex = to_landmark_.data() + vertex * count;
+    const double* to_target = to_landmark_.data() + target * count;
+    double bound = 0;
+    for (size_t i = 0; i < count; ++i) {
+        // Если ориентир достижим из цели, а из вершины нет, то и цель из вершины недостижима.
+        // Аналогично, если вершина достижима из ориентира, а цель нет
+        if (to_target[i] != INF) {
+            if (to_vertex[i] == INF) {
+                return INF;
+            }
+            bound = std::max(bound, to_vertex[i] - to_target[i]);
+        }
+        if (from_vertex[i] != INF) {
+            if (from_target[i] == INF) {
+                return INF;
+            }
+            bound = std::max(bound, from_target[i] - from_vertex[i]);
+        }
+    }
+    return bound;
+}
+
+template <typename Weight>
+std::optional<typename AltRouter<Weight>::RouteInfo> AltRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    if (from == to) {
+        return RouteInfo{Weight{}, {}};
+    }
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (LowerBound(from, to) == INF) {
+        return std::nullopt;
+    }
+
+    // Потенциал прямого поиска; обратный поиск использует его со знаком минус.
+    // Вершины, через которые пути из from в to нет, отмечаются NaN и не просматриваются
+    std::vector<double> potential(vertex_count, INF);
+    auto get_potential = [&](VertexId vertex) {
+        if (potential[vertex] == INF) {
+            const double to_target = LowerBound(vertex, to);
+            const double from_source = LowerBound(from, vertex);
+            potential[vertex] = to_target == INF || from_source == INF
+                                ? std::numeric_limits<double>::quiet_NaN()
+                                : (to_target - from_source) / 2;
+        }
+        return potential[vertex];
+    };
+
+    struct Side {
+        std::vector<Weight> distance;
+        std::vector<bool> reached;
+        std::vector<EdgeId> edge;
+        std::priority_queue<std::pair<double, VertexId>, std::vector<std::pair<double, VertexId>>, std::greater<>> queue;
+    };
+    Side sides[2];
+    for (Side& side : sides) {
+        side.distance.assign(vertex_count, Weight{});
+        side.reached.assign(vertex_count, false);
+        side.edge.assign(vertex_count, NO_EDGE);
+    }
+    sides[0].reached[from] = true;
+    sides[0].queue.push({get_potential(from), from});
+    sides[1].reached[to] = true;
+    sides[1].queue.push({-get_potential(to), to});
+
+    std::optional<Weight> best;
+    VertexId meeting = from;
+    while (!sides[0].queue.empty() && !sides[1].queue.empty()) {
+        if (best && sides[0].queue.top().first + sides[1].queue.top().first >= static_cast<double>(*best)) {
+            break;
+        }
+        // Продвигается поиск с меньшей очередью
+        const size_t direction = sides[0].queue.size() <= sides[1].queue.size() ? 0 : 1;
+        Side& side = sides[direction];
+        const Side& other = sides[1 - direction];
+        const auto [key, vertex] = side.queue.top();
+        side.queue.pop();
+        const double sign = direction == 0 ? 1.0 : -1.0;
+        if (key > static_cast<double>(side.distance[vertex]) + sign * get_potential(vertex)) {
+            continue;
+        }
+        for (const EdgeId edge_id : direction == 0 ? graph_.GetIncidentEdges(vertex) : graph_.GetIncomingEdges(vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const VertexId next = direction == 0 ? edge.to : edge.from;
+            const double next_potential = get_potential(next);
+            if (std::isnan(next_potential)) {
+                continue;
+            }
+            const Weight candidate = side.distance[vertex] + edge.weight;
+            if (side.reached[next] && !(candidate < side.distance[next])) {
+                continue;
+            }
+            side.reached[next] = true;
+            side.distance[next] = candidate;
+            side.edge[next] = edge_id;
+            side.queue.push({static_cast<double>(candidate) + sign * next_potential, next});
+            if (other.reached[next] && (!best || candidate + other.distance[next] < *best)) {
+                best = candidate + other.distance[next];
+                meeting = next;
+            }
+        }
+    }
+    if (!best) {
+        return std::nullopt;
+    }
+
+    RouteInfo route{*best, {}};
+    for (VertexId vertex = meeting; sides[0].edge[vertex] != NO_EDGE; vertex = graph_.GetEdge(sides[0].edge[vertex]).from) {
+        route.edges.push_back(sides[0].edge[vertex]);
+    }
+    std::reverse(route.edges.begin(), route.edges.end());
+    for (VertexId vertex = meeting; sides[1].edge[vertex] != NO_EDGE; vertex = graph_.GetEdge(sides[1].edge[vertex]).to) {
+        route.edges.push_back(sides[1].edge[vertex]);
+    }
+    return route;
+}
+
+}  // namespace graph
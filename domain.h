@@ -33,10 +33,33 @@ struct Bus {
     std::string name;
     std::vector<Stop*> stop_names;
     bool round_route;
+    // Расписание: для каждого рейса время отправления с каждой остановки stop_names
+    // в минутах от начала суток. Рейсы упорядочены по отправлению и не обгоняют друг друга
+    std::vector<std::vector<double>> trips{};
+    // Отправления с первой остановки в минутах от начала суток, по возрастанию. Времена на остальных
+    // остановках зависят от скорости автобуса и вычисляются при построении маршрутизатора по расписанию
+    std::vector<double> departures{};
 };
 
 using BusPtr = Bus*;
 
+// Остановки маршрута, у которых выводится название автобуса: первая и,
+// для некольцевого маршрута с разными конечными, вторая конечная
+struct BusTerminals {
+    size_t count = 0;
+    size_t index[2] = {0, 0};
+};
+
+// Порядок вывода карты, подготовленный справочником заранее, чтобы при отрисовке
+// не сортировать автобусы и остановки и не вычислять конечные
+struct RenderOrder {
+    // Все автобусы в порядке названий и их конечные (terminals[i] относится к buses[i])
+    std::vector<const Bus*> buses;
+    std::vector<BusTerminals> terminals;
+    // Остановки, через которые проходит хотя бы один автобус, в порядке названий
+    std::vector<const Stop*> stops;
+};
+
 struct BusStat {
     double curvature;
     int id;
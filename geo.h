@@ -15,12 +15,5 @@ namespace transport::geo {
         }
     };
 
-    class CoordinatesHasher {
-    public:
-        size_t operator() (const Coordinates& coord) const {
-            return static_cast<size_t>(coord.lat * 37 + coord.lng);
-        }
-    };
-
     double ComputeDistance(Coordinates from, Coordinates to);
 }
\ No newline at end of file
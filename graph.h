@@ -18,7 +18,19 @@ struct Edge {
     std::string bus_name;
     std::string stop_name;
     int num_stops;
-    double ride_time;
+    // Расстояние в метрах; вес ребра вычисляется из него по настройкам маршрутизации
+    double distance;
+    // Переход пешком между соседними остановками, а не поездка на автобусе
+    bool walk = false;
+};
+
+// Вес ребра, хранящийся в графе. Маршрутизаторы, принимающие функтор веса ребра, используют его
+// по умолчанию; другой функтор позволяет искать с другими весами без копирования графа
+template <typename Weight>
+struct StoredEdgeWeight {
+    Weight operator()(const Edge<Weight>& edge) const {
+        return edge.weight;
+    }
 };
 
 template <typename Weight>
@@ -31,20 +43,27 @@ public:
     DirectedWeightedGraph() = default;
     explicit DirectedWeightedGraph(size_t vertex_count);
     EdgeId AddEdge(const Edge<Weight>& edge);
+    // Увеличивает число вершин до vertex_count, если их меньше
+    void AddVertices(size_t vertex_count);
+    void SetEdgeWeight(EdgeId edge_id, Weight weight);
 
     size_t GetVertexCount() const;
     size_t GetEdgeCount() const;
     const Edge<Weight>& GetEdge(EdgeId edge_id) const;
     IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
+    // Рёбра, входящие в вершину, - для поиска в обратном направлении
+    IncidentEdgesRange GetIncomingEdges(VertexId vertex) const;
 
 private:
     std::vector<Edge<Weight>> edges_;
     std::vector<IncidenceList> incidence_lists_;
+    std::vector<IncidenceList> incoming_lists_;
 };
 
 template <typename Weight>
 DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-    : incidence_lists_(vertex_count) {
+    : incidence_lists_(vertex_count)
+    , incoming_lists_(vertex_count) {
 }
 
 template <typename Weight>
@@ -52,9 +71,23 @@ EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
     edges_.push_back(edge);
     const EdgeId id = edges_.size() - 1;
     incidence_lists_.at(edge.from).push_back(id);
+    incoming_lists_.at(edge.to).push_back(id);
     return id;
 }
 
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::AddVertices(size_t vertex_count) {
+    if (vertex_count > incidence_lists_.size()) {
+        incidence_lists_.resize(vertex_count);
+        incoming_lists_.resize(vertex_count);
+    }
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::SetEdgeWeight(EdgeId edge_id, Weight weight) {
+    edges_.at(edge_id).weight = weight;
+}
+
 template <typename Weight>
 size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
     return incidence_lists_.size();
@@ -75,4 +108,10 @@ typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
 DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
     return ranges::AsRange(incidence_lists_.at(vertex));
 }
+
+template <typename Weight>
+typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
+DirectedWeightedGraph<Weight>::GetIncomingEdges(VertexId vertex) const {
+    return ranges::AsRange(incoming_lists_.at(vertex));
+}
 }  // namespace graph
\ No newline at end of file
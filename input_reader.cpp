@@ -1,145 +1,213 @@
 #include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fcntl.h>
 #include "input_reader.h"
-#include <iostream>
+#include <iterator>
+#include <stdexcept>
 #include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
 
 using namespace std;
 
 namespace transport::input {
-/**
- * Парсит строку вида "10.123,  -30.1837" и возвращает пару координат (широта, долгота)
- */
-    geo::Coordinates ParseCoordinates(std::string_view str) {
-        static const double nan = std::nan("");
 
-        auto not_space = str.find_first_not_of(' ');
-        auto comma = str.find(',');
-
-        if (comma == str.npos) {
-            return {nan, nan};
+    namespace {
+
+    /**
+     * Файл, отображённый в память только для чтения. Отображение снимается в деструкторе
+     */
+    class MappedFile {
+    public:
+        explicit MappedFile(const string& path) {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw runtime_error("Cannot open " + path);
+            }
+            struct stat info{};
+            if (fstat(fd, &info) < 0) {
+                close(fd);
+                throw runtime_error("Cannot stat " + path);
+            }
+            size_ = static_cast<size_t>(info.st_size);
+            if (size_ > 0) {
+                void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED) {
+                    close(fd);
+                    throw runtime_error("Cannot map " + path);
+                }
+                data_ = static_cast<const char*>(data);
+                madvise(data, size_, MADV_SEQUENTIAL);
+            }
+            close(fd);
         }
 
-        auto not_space2 = str.find_first_not_of(' ', comma + 1);
-
-        double lat = std::stod(std::string(str.substr(not_space, comma - not_space)));
-        double lng = std::stod(std::string(str.substr(not_space2)));
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
 
-        return {lat, lng};
-    }
-
-/**
- * Удаляет пробелы в начале и конце строки
- */
-    std::string_view Trim(std::string_view string) {
-        const auto start = string.find_first_not_of(' ');
-        if (start == string.npos) {
-            return {};
+        ~MappedFile() {
+            if (data_ != nullptr) {
+                munmap(const_cast<char*>(data_), size_);
+            }
         }
-        return string.substr(start, string.find_last_not_of(' ') + 1 - start);
-    }
 
-    vector<catalogue::Distance> ParseDistance(std::string_view str) {
-        auto comma = str.find(',');
-        comma = str.find(',', comma + 1);
+        string_view View() const {
+            return {data_, size_};
+        }
 
-        if (comma == str.npos) {
+    private:
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    /**
+     * Удаляет пробелы в начале и конце строки
+     */
+    string_view Trim(string_view str) {
+        const auto start = str.find_first_not_of(' ');
+        if (start == str.npos) {
             return {};
         }
+        return str.substr(start, str.find_last_not_of(' ') + 1 - start);
+    }
 
-        vector<catalogue::Distance> distances;
-
-        str = Trim(str.substr(comma + 1));
-        while (str.length() > 0) {
-            comma = str.find(',');
-            string_view work_str = str.substr(0, comma);
-            auto meter = work_str.find('m');
-            int dist = stoi(string(work_str.substr(0, meter + 1)));
-            work_str = Trim(work_str.substr(meter + 1));
-            work_str = Trim(work_str.substr((work_str.find_first_not_of("to"))));
-            distances.push_back({pair<std::string, std::string>{"1", work_str}, dist});
+    /**
+     * Отделяет от строки часть до разделителя delim и возвращает её без пробелов по краям.
+     * Сама строка укорачивается до остатка после разделителя
+     */
+    string_view NextToken(string_view& str, char delim) {
+        const auto pos = str.find(delim);
+        const string_view token = Trim(str.substr(0, pos));
+        str = pos == str.npos ? string_view{} : str.substr(pos + 1);
+        return token;
+    }
 
-            str = comma != str.npos ? Trim(str.substr(comma + 1)) : "";
+    double ParseDouble(string_view str) {
+        str = Trim(str);
+        if (!str.empty() && str.front() == '+') {
+            str.remove_prefix(1);
         }
-
-        return distances;
+        double value = nan("");
+        from_chars(str.data(), str.data() + str.size(), value);
+        return value;
     }
 
-/**
- * Разбивает строку string на n строк, с помощью указанного символа-разделителя delim
- */
-    std::vector<std::string_view> Split(std::string_view string, char delim) {
-        std::vector<std::string_view> result;
-
-        size_t pos = 0;
-        while ((pos = string.find_first_not_of(' ', pos)) < string.length()) {
-            auto delim_pos = string.find(delim, pos);
-            if (delim_pos == string.npos) {
-                delim_pos = string.size();
-            }
-            if (auto substr = Trim(string.substr(pos, delim_pos - pos)); !substr.empty()) {
-                result.push_back(substr);
-            }
-            pos = delim_pos + 1;
+    /**
+     * Возвращает очередную строку буфера без завершающих \n и \r
+     */
+    string_view NextLine(string_view& data) {
+        const auto pos = data.find('\n');
+        string_view line = data.substr(0, pos);
+        data = pos == data.npos ? string_view{} : data.substr(pos + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
         }
-
-        return result;
+        return line;
     }
 
-/**
- * Парсит маршрут.
- * Для кольцевого маршрута (A>B>C>A) возвращает массив названий остановок [A,B,C,A]
- * Для некольцевого маршрута (A-B-C-D) возвращает массив названий остановок [A,B,C,D,C,B,A]
- */
-    std::vector<std::string_view> ParseRoute(std::string_view route) {
-        if (route.find('>') != route.npos) {
-            return Split(route, '>');
-        }
+    }  // namespace
 
-        auto stops = Split(route, '-');
-        std::vector<std::string_view> results(stops.begin(), stops.end());
-        results.insert(results.end(), std::next(stops.rbegin()), stops.rend());
+    InputReader::InputReader(catalogue::TransportCatalogue& catalogue, TransportRouter& router)
+            : catalogue_(catalogue), router_(router) {
+    }
 
-        return results;
+    void InputReader::ReadFile(const std::string& path) {
+        MappedFile file(path);
+        Parse(file.View());
     }
 
-    CommandDescription ParseCommandDescription(std::string_view line) {
-        auto colon_pos = line.find(':');
-        if (colon_pos == line.npos) {
-            return {};
-        }
+    void InputReader::ReadInput(std::istream& in) {
+        const string buffer{istreambuf_iterator<char>(in), istreambuf_iterator<char>()};
+        Parse(buffer);
+    }
 
-        auto space_pos = line.find(' ');
-        if (space_pos >= colon_pos) {
-            return {};
+    void InputReader::Parse(std::string_view data) {
+        // Первая строка - число последующих строк с командами
+        string_view first_line = Trim(NextLine(data));
+        size_t line_count = 0;
+        from_chars(first_line.data(), first_line.data() + first_line.size(), line_count);
+
+        // Маршруты ссылаются на остановки, поэтому применяются после всех остановок
+        vector<pair<string_view, string_view>> buses;
+        for (size_t i = 0; i < line_count && !data.empty(); ++i) {
+            string_view line = NextLine(data);
+            const auto colon_pos = line.find(':');
+            if (colon_pos == line.npos) {
+                continue;
+            }
+            string_view header = Trim(line.substr(0, colon_pos));
+            const auto space_pos = header.find(' ');
+            if (space_pos == header.npos) {
+                continue;
+            }
+            const string_view command = header.substr(0, space_pos);
+            const string_view id = Trim(header.substr(space_pos + 1));
+            const string_view description = line.substr(colon_pos + 1);
+
+            if (command == "Stop"sv) {
+                ApplyStop(id, description);
+            } else if (command == "Bus"sv) {
+                buses.emplace_back(id, description);
+            }
         }
 
-        auto not_space = line.find_first_not_of(' ', space_pos);
-        if (not_space >= colon_pos) {
-            return {};
+        for (const auto& [name, description] : buses) {
+            ApplyBus(name, description);
         }
-
-        return {std::string(line.substr(0, space_pos)),
-                std::string(line.substr(not_space, colon_pos - not_space)),
-                std::string(line.substr(colon_pos + 1))};
     }
 
-    void InputReader::ParseLine(std::string_view line) {
-        auto command_description = ParseCommandDescription(line);
-        if (command_description) {
-            commands_.push_back(std::move(command_description));
+/**
+ * Парсит описание остановки вида "10.123,  -30.1837, 3900m to Y, 1200m to Z"
+ */
+    void InputReader::ApplyStop(std::string_view name, std::string_view description) {
+        const double lat = ParseDouble(NextToken(description, ','));
+        const double lng = ParseDouble(NextToken(description, ','));
+        Stop stop = {string(name), {lat, lng}, 0};
+        catalogue_.AddStop(stop);
+
+        while (!description.empty()) {
+            string_view item = NextToken(description, ',');
+            const auto meter = item.find('m');
+            if (meter == item.npos) {
+                continue;
+            }
+            int dist = 0;
+            from_chars(item.data(), item.data() + meter, dist);
+            item = Trim(item.substr(meter + 1));
+            if (item.substr(0, 2) == "to"sv) {
+                item = Trim(item.substr(2));
+            }
+            catalogue::Distance distance;
+            distance.stop_pair.pair_stop = {string(name), string(item)};
+            distance.distance = dist;
+            catalogue_.AddDistance(distance);
         }
     }
 
-
-
-    void InputReader::ReadInput(std::istream& in) {
-        int base_request_count;
-        in >> base_request_count >> ws;
-        for (int i = 0; i < base_request_count; ++i) {
-            string line;
-            getline(in, line);
-            ParseLine(line);
+/**
+ * Парсит маршрут.
+ * Для кольцевого маршрута (A>B>C>A) добавляет остановки [A,B,C,A]
+ * Для некольцевого маршрута (A-B-C-D) добавляет остановки [A,B,C,D,C,B,A]
+ */
+    void InputReader::ApplyBus(std::string_view name, std::string_view description) {
+        const bool round_route = description.find('>') != description.npos;
+        const char delim = round_route ? '>' : '-';
+
+        Bus bus = {string(name), vector<Stop*>(), round_route};
+        while (!description.empty()) {
+            if (string_view stop = NextToken(description, delim); !stop.empty()) {
+                bus.stop_names.push_back(catalogue_.FindStop(stop));
+            }
+        }
+        if (!round_route) {
+            for (int ind = static_cast<int>(bus.stop_names.size()) - 2; ind >= 0; --ind) {
+                bus.stop_names.push_back(bus.stop_names[ind]);
+            }
         }
+        catalogue_.AddBus(bus, router_);
     }
 }
 
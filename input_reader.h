@@ -1,43 +1,50 @@
 #pragma once
 
 #include "geo.h"
+#include <iostream>
 #include <string>
 #include <string_view>
 #include "transport_catalogue.h"
+#include "transport_router.h"
 #include <vector>
 
 namespace transport::input {
 
-    struct CommandDescription {
-        // Определяет, задана ли команда (поле command непустое)
-        explicit operator bool() const {
-            return !command.empty();
-        }
-
-        bool operator!() const {
-            return !operator bool();
-        }
-
-        std::string command;      // Название команды
-        std::string id;           // id маршрута или остановки
-        std::string description;  // Параметры команды
-    };
-
+    /**
+     * Читает базу в старом построчном текстовом формате:
+     *   <количество строк>
+     *   Stop X: 55.611087, 37.20829, 3900m to Y, 1200m to Z
+     *   Bus 256: A > B > C > A
+     *   Bus 750: A - B - C
+     *
+     * Разбор идёт без копирования по string_view прямо из входного буфера, числа
+     * читаются через from_chars. Остановки и расстояния передаются в справочник сразу,
+     * маршруты - после того, как прочитаны все остановки.
+     */
     class InputReader {
     public:
+        InputReader(catalogue::TransportCatalogue& catalogue, TransportRouter& router);
+
         /**
-         * Парсит строку в структуру CommandDescription и сохраняет результат в commands_
+         * Отображает файл в память через mmap и разбирает его
          */
-        void ParseLine(std::string_view line);
+        void ReadFile(const std::string& path);
 
         /**
-         * Наполняет данными транспортный справочник, используя команды из commands_
+         * Считывает поток целиком в буфер и разбирает его
          */
-        void ApplyCommands(catalogue::TransportCatalogue& catalogue) const;
-
         void ReadInput(std::istream& in);
 
+        /**
+         * Разбирает данные в старом формате. Буфер должен жить до конца вызова
+         */
+        void Parse(std::string_view data);
+
     private:
-        std::vector<CommandDescription> commands_;
+        void ApplyStop(std::string_view name, std::string_view description);
+        void ApplyBus(std::string_view name, std::string_view description);
+
+        catalogue::TransportCatalogue& catalogue_;
+        TransportRouter& router_;
     };
 }
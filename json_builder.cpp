@@ -25,13 +25,12 @@ Builder& Builder::Value(Node val) {
         nodes_.back().AsArray().emplace_back(move(val));
         new_element = true;
     } else if (!nodes_.empty() && nodes_.back().IsDict()) {
-        nodes_.back().AsDict()[keys_.back()] = val;
+        nodes_.back().AsDict()[keys_.back()] = move(val);
         keys_.pop_back();
         key_ = false;
         new_element = false;
     } else {
-        node_ = Node(val);
-        nodes_.push_back(move(node_));
+        nodes_.push_back(move(val));
         new_element = false;
     }
     return *this;
@@ -72,11 +71,11 @@ Builder& Builder::EndDict() {
         throw logic_error("No StartDict found");
     }
     if (nodes_.size() > 1 && nodes_[nodes_.size() - 2].IsDict()) {
-        nodes_[nodes_.size() - 2].AsDict()[keys_.back()] = nodes_.back();
+        nodes_[nodes_.size() - 2].AsDict()[keys_.back()] = move(nodes_.back());
         keys_.pop_back();
         nodes_.pop_back();
     } else if (nodes_.size() > 1 && nodes_[nodes_.size() - 2].IsArray()) {
-        nodes_[nodes_.size() - 2].AsArray().emplace_back(nodes_.back());
+        nodes_[nodes_.size() - 2].AsArray().emplace_back(move(nodes_.back()));
         nodes_.pop_back();
         new_element = true;
     }
@@ -92,10 +91,10 @@ Builder& Builder::EndArray() {
         throw logic_error("Last node is not Array");
     }
     if (nodes_.size() > 1 && nodes_[nodes_.size() - 2].IsArray()) {
-        nodes_[nodes_.size() - 2].AsArray().emplace_back(nodes_.back());
+        nodes_[nodes_.size() - 2].AsArray().emplace_back(move(nodes_.back()));
         nodes_.pop_back();
     } else if (nodes_.size() > 1 && nodes_[nodes_.size() - 2].IsDict()) {
-        nodes_[nodes_.size() - 2].AsDict()[keys_.back()] = nodes_.back();
+        nodes_[nodes_.size() - 2].AsDict()[keys_.back()] = move(nodes_.back());
         keys_.pop_back();
         nodes_.pop_back();
 
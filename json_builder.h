@@ -67,7 +67,7 @@ public:
     KeyContext(Builder& builder)
         : builder_(builder) {};
     DictContext& Value(Node node) {
-        builder_.Value(node);
+        builder_.Value(std::move(node));
         auto tmp = new DictContext(builder_);
         return *tmp;
     }
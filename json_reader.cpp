@@ -1,12 +1,16 @@
+#include <algorithm>
 #include "json_reader.h"
 #include "json_builder.h"
 #include <sstream>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
 
 using namespace std;
 
 namespace json {
 
-svg::Color ReadNode(Node node);
+svg::Color ReadNode(const Node& node);
 
 Document::Document(Node root)
         : root_(move(root)) {
@@ -16,15 +20,26 @@ Node &Document::GetRoot() {
     return root_;
 }
 
+const Node &Document::GetRoot() const {
+    return root_;
+}
+
 Document Load(istream &input) {
-    Node node = LoadNode(input);
-    return Document{node};
+    return Document{LoadNode(input)};
 }
 
-void Print(Document &doc, std::ostream &output) {
+void Print(const Document &doc, std::ostream &output) {
     PrintNode(doc.GetRoot(), output);
 }
 
+Document LoadBinary(istream &input) {
+    return Document{LoadBinaryNode(input)};
+}
+
+void PrintBinary(const Document &doc, std::ostream &output) {
+    PrintBinaryNode(doc.GetRoot(), output);
+}
+
 bool Document::operator==(const Document &other) const {
     return root_ == other.root_;
 }
@@ -34,30 +49,84 @@ bool Document::operator!=(const Document &other) const {
 }
 
 void JsonReader::SetDoc(Document&& document) {
-    doc_ = document;
+    doc_ = std::move(document);
+    render_settings_.reset();
 }
 
 Document& JsonReader::GetDoc() {
     return doc_;
 }
 
+const Document& JsonReader::GetDoc() const {
+    return doc_;
+}
+
 JsonReader::JsonReader(Document document)
     : doc_(std::move(document))
 {
 }
 
-void JsonReader::ReadRouterSettings(transport::catalogue::TransportCatalogue &catalogue) {
-    auto router_setting = doc_.GetRoot().AsDict().at("routing_settings").AsDict();
-    catalogue.SetWait(router_setting.at("bus_wait_time").AsInt());
-    catalogue.SetVelocity(router_setting.at("bus_velocity").AsDouble());
+void JsonReader::SetOutputFormat(Format format) {
+    output_format_ = format;
+}
+
+TransportRouter& JsonReader::GetRouter() {
+    return router_;
 }
 
-RenderSettings JsonReader::ReadSettings() {
+void JsonReader::ReadRouterSettings() {
+    const auto& router_setting = doc_.GetRoot().AsDict().at("routing_settings").AsDict();
+    RoutingSettings settings;
+    settings.bus_wait_time = router_setting.at("bus_wait_time").AsInt();
+    settings.bus_velocity = router_setting.at("bus_velocity").AsDouble();
+    if (router_setting.count("walking_speed") > 0) {
+        settings.walking_speed = router_setting.at("walking_speed").AsDouble();
+    }
+    if (router_setting.count("walking_radius") > 0) {
+        settings.walking_radius = router_setting.at("walking_radius").AsDouble();
+    }
+    // Веса рёбер: "double" (по умолчанию) - время в минутах, "integer" - целое число десятых долей секунды
+    if (router_setting.count("weights") > 0) {
+        const string_view weights = router_setting.at("weights").AsStringView();
+        if (weights != "integer"sv && weights != "double"sv) {
+            throw invalid_argument("Unknown weight type " + string(weights));
+        }
+        settings.integer_weights = weights == "integer"sv;
+    }
+    router_.SetSettings(settings);
+    if (router_setting.count("algorithm") > 0) {
+        const string_view algorithm = router_setting.at("algorithm").AsStringView();
+        size_t landmark_count = TransportRouter::DEFAULT_LANDMARK_COUNT;
+        if (router_setting.count("landmark_count") > 0) {
+            landmark_count = static_cast<size_t>(max(router_setting.at("landmark_count").AsInt(), 0));
+        }
+        if (algorithm == "landmarks"sv) {
+            router_.SetAlgorithm(RouterAlgorithm::LANDMARKS, landmark_count);
+        } else if (algorithm == "table"sv) {
+            router_.SetAlgorithm(RouterAlgorithm::TABLE);
+        } else {
+            throw invalid_argument("Unknown routing algorithm " + string(algorithm));
+        }
+    }
+    if (router_setting.count("vertex_order") > 0) {
+        const string_view order = router_setting.at("vertex_order").AsStringView();
+        if (order == "cuthill_mckee"sv) {
+            router_.SetVertexOrder(VertexOrder::CUTHILL_MCKEE);
+        } else if (order == "input"sv) {
+            router_.SetVertexOrder(VertexOrder::INPUT);
+        } else {
+            throw invalid_argument("Unknown vertex order " + string(order));
+        }
+    }
+}
+
+RenderSettings JsonReader::ReadSettings() const {
     RenderSettings setting;
-    if (doc_.GetRoot().AsDict().count("render_settings") == 0) {
+    const auto& root = doc_.GetRoot().AsDict();
+    if (root.count("render_settings") == 0) {
         return setting;
     }
-    auto render = doc_.GetRoot().AsDict().at("render_settings").AsDict();
+    const auto& render = root.at("render_settings").AsDict();
     setting.width = render.at("width").AsDouble();
     setting.height = render.at("height").AsDouble();
     setting.padding = render.at("padding").AsDouble();
@@ -71,17 +140,32 @@ RenderSettings JsonReader::ReadSettings() {
     setting.stop_label_offset.second = render.at("stop_label_offset").AsArray().at(1).AsDouble();
     setting.underlayer_color = ReadNode(render.at("underlayer_color"));
     setting.underlayer_width = render.at("underlayer_width").AsDouble();
-    for (auto& color : render.at("color_palette").AsArray()) {
+    if (render.count("stop_label_min_zoom") > 0) {
+        setting.stop_label_min_zoom = render.at("stop_label_min_zoom").AsInt();
+    }
+    if (render.count("route_simplify_tolerance") > 0) {
+        setting.route_simplify_tolerance = render.at("route_simplify_tolerance").AsDouble();
+    }
+    if (render.count("compact_svg") > 0) {
+        setting.compact_svg = render.at("compact_svg").AsBool();
+    }
+    if (render.count("compact_svg_precision") > 0) {
+        setting.compact_svg_precision = render.at("compact_svg_precision").AsInt();
+    }
+    if (render.count("tile_cache_dir") > 0) {
+        setting.tile_cache_dir = render.at("tile_cache_dir").AsString();
+    }
+    for (const auto& color : render.at("color_palette").AsArray()) {
         setting.color_palette.push_back(ReadNode(color));
     }
     return setting;
 }
 
 void JsonReader::ReadBaseRequest(transport::catalogue::TransportCatalogue& catalogue) {
-    auto base = doc_.GetRoot().AsDict().at("base_requests").AsArray();
-    for (Node request : base) {
-        auto item = request.AsDict();
-        if (item.at("type").AsString() == "Stop") {
+    const auto& base = doc_.GetRoot().AsDict().at("base_requests").AsArray();
+    for (const Node& request : base) {
+        const auto& item = request.AsDict();
+        if (item.at("type").AsStringView() == "Stop") {
             Stop stop = {item.at("name").AsString(),
                          {item.at("latitude").AsDouble(),
                           item.at("longitude").AsDouble()}, 0};
@@ -89,12 +173,12 @@ void JsonReader::ReadBaseRequest(transport::catalogue::TransportCatalogue& catal
         }
     }
 
-    for (Node request : base) {
-        auto item = request.AsDict();
-        if (item.at("type").AsString() == "Stop") {
-            auto distance = item.at("road_distances").AsDict();
-            string name = item.at("name").AsString();
-            for (auto& [key, value] : distance) {
+    for (const Node& request : base) {
+        const auto& item = request.AsDict();
+        if (item.at("type").AsStringView() == "Stop") {
+            const auto& distance = item.at("road_distances").AsDict();
+            const string& name = item.at("name").AsString();
+            for (const auto& [key, value] : distance) {
                 transport::catalogue::Distance distance_elem;
                 distance_elem.stop_pair.pair_stop.first = name;
                 distance_elem.stop_pair.pair_stop.second = key;
@@ -104,13 +188,12 @@ void JsonReader::ReadBaseRequest(transport::catalogue::TransportCatalogue& catal
         }
     }
 
-    for (Node request : base) {
-        auto item = request.AsDict();
-        if (item.at("type").AsString() == "Bus") {
-            string name = item.at("name").AsString();
-            Bus bus = {name, vector<Stop*>(), false};
-            for (auto& stop : item.at("stops").AsArray()) {
-                bus.stop_names.push_back(catalogue.FindStop(stop.AsString()));
+    for (const Node& request : base) {
+        const auto& item = request.AsDict();
+        if (item.at("type").AsStringView() == "Bus") {
+            Bus bus = {item.at("name").AsString(), vector<Stop*>(), false};
+            for (const auto& stop : item.at("stops").AsArray()) {
+                bus.stop_names.push_back(catalogue.FindStop(stop.AsStringView()));
             }
             if (!item.at("is_roundtrip").AsBool()) {
                 for (int ind = bus.stop_names.size() - 2; ind >= 0; --ind) {
@@ -120,114 +203,617 @@ void JsonReader::ReadBaseRequest(transport::catalogue::TransportCatalogue& catal
             } else {
                 bus.round_route = true;
             }
+            // Расписание задаётся либо временами отправления с первой остановки (времена на
+            // остальных вычисляются по скорости автобуса), либо временами на всех остановках
+            if (item.count("departures") > 0) {
+                for (const auto& departure : item.at("departures").AsArray()) {
+                    bus.departures.push_back(departure.AsDouble());
+                }
+            }
+            if (item.count("trips") > 0) {
+                for (const auto& trip : item.at("trips").AsArray()) {
+                    vector<double>& times = bus.trips.emplace_back();
+                    for (const auto& time : trip.AsArray()) {
+                        times.push_back(time.AsDouble());
+                    }
+                }
+            }
             catalogue.AddBus(bus, router_);
         }
     }
 }
 
+StatRequest ParseStatRequest(const Dict& request) {
+    // Поля запроса к справочнику; ключи, которых нет в таблице, пропускаются
+    enum class Field {
+        TYPE,
+        ID,
+        NAME,
+        FROM,
+        TO,
+        VIEWPORT,
+        ZOOM,
+        X,
+        Y,
+        DEPARTURE_TIME,
+        PARETO,
+        MAX_EXTRA_TIME,
+        COUNT,
+        MAX_SIMILARITY,
+        BUS_WAIT_TIME,
+        BUS_VELOCITY,
+        ORIGINS,
+        DESTINATIONS,
+    };
+    static const unordered_map<string_view, Field> fields = {
+        {"type"sv, Field::TYPE},
+        {"id"sv, Field::ID},
+        {"name"sv, Field::NAME},
+        {"from"sv, Field::FROM},
+        {"to"sv, Field::TO},
+        {"viewport"sv, Field::VIEWPORT},
+        {"zoom"sv, Field::ZOOM},
+        {"x"sv, Field::X},
+        {"y"sv, Field::Y},
+        {"departure_time"sv, Field::DEPARTURE_TIME},
+        {"pareto"sv, Field::PARETO},
+        {"max_extra_time"sv, Field::MAX_EXTRA_TIME},
+        {"count"sv, Field::COUNT},
+        {"max_similarity"sv, Field::MAX_SIMILARITY},
+        {"bus_wait_time"sv, Field::BUS_WAIT_TIME},
+        {"bus_velocity"sv, Field::BUS_VELOCITY},
+        {"origins"sv, Field::ORIGINS},
+        {"destinations"sv, Field::DESTINATIONS},
+    };
+
+    RequestType type = RequestType::UNKNOWN;
+    int id = 0;
+    string_view name;
+    string_view from;
+    string_view to;
+    optional<Viewport> viewport;
+    int zoom = 0;
+    int x = 0;
+    int y = 0;
+    optional<double> departure_time;
+    bool pareto = false;
+    optional<double> max_extra_time;
+    optional<int> count;
+    double max_similarity = 1.0;
+    optional<int> bus_wait_time;
+    optional<double> bus_velocity;
+    vector<string_view> origins;
+    vector<string_view> destinations;
+    for (const auto& [key, value] : request) {
+        const auto field = fields.find(key);
+        if (field == fields.end()) {
+            continue;
+        }
+        switch (field->second) {
+            case Field::TYPE:
+                type = ParseRequestType(value.AsStringView());
+                break;
+            case Field::ID:
+                id = value.AsInt();
+                break;
+            case Field::NAME:
+                name = value.AsStringView();
+                break;
+            case Field::FROM:
+                from = value.AsStringView();
+                break;
+            case Field::TO:
+                to = value.AsStringView();
+                break;
+            case Field::VIEWPORT: {
+                const auto& area = value.AsDict();
+                viewport = Viewport{area.at("min_lat").AsDouble(), area.at("min_lng").AsDouble(),
+                                    area.at("max_lat").AsDouble(), area.at("max_lng").AsDouble()};
+                break;
+            }
+            case Field::ZOOM:
+                zoom = value.AsInt();
+                break;
+            case Field::X:
+                x = value.AsInt();
+                break;
+            case Field::Y:
+                y = value.AsInt();
+                break;
+            case Field::DEPARTURE_TIME:
+                departure_time = value.AsDouble();
+                break;
+            case Field::PARETO:
+                pareto = value.AsBool();
+                break;
+            case Field::MAX_EXTRA_TIME:
+                max_extra_time = value.AsDouble();
+                break;
+            case Field::COUNT:
+                count = value.AsInt();
+                break;
+            case Field::MAX_SIMILARITY:
+                max_similarity = value.AsDouble();
+                break;
+            case Field::BUS_WAIT_TIME:
+                bus_wait_time = value.AsInt();
+                break;
+            case Field::BUS_VELOCITY:
+                bus_velocity = value.AsDouble();
+                break;
+            case Field::ORIGINS:
+            case Field::DESTINATIONS: {
+                vector<string_view>& names = field->second == Field::ORIGINS ? origins : destinations;
+                names.reserve(value.AsArray().size());
+                for (const auto& name_node : value.AsArray()) {
+                    names.push_back(name_node.AsStringView());
+                }
+                break;
+            }
+        }
+    }
+
+    switch (type) {
+        case RequestType::BUS:
+            return {type, BusQuery{id, name}};
+        case RequestType::STOP:
+            return {type, StopQuery{id, name}};
+        case RequestType::MAP:
+            return {type, MapQuery{id, viewport, zoom}};
+        case RequestType::ROUTE:
+            return {type, RouteQuery{id, from, to, departure_time, pareto, max_extra_time, count, max_similarity,
+                                     bus_wait_time, bus_velocity}};
+        case RequestType::TILE:
+            return {type, TileQuery{id, Tile{zoom, x, y}}};
+        case RequestType::MATRIX:
+            return {type, MatrixQuery{id, move(origins), move(destinations)}};
+        default:
+            return {};
+    }
+}
+
+RequestType ParseRequestType(string_view type) {
+    switch (type.empty() ? '\0' : type.front()) {
+        case 'B':
+            return type == "Bus"sv ? RequestType::BUS : RequestType::UNKNOWN;
+        case 'S':
+            return type == "Stop"sv ? RequestType::STOP : RequestType::UNKNOWN;
+        case 'M':
+            return type == "Map"sv ? RequestType::MAP : type == "Matrix"sv ? RequestType::MATRIX : RequestType::UNKNOWN;
+        case 'R':
+            return type == "Route"sv ? RequestType::ROUTE : RequestType::UNKNOWN;
+        case 'T':
+            return type == "Tile"sv ? RequestType::TILE : RequestType::UNKNOWN;
+        default:
+            return RequestType::UNKNOWN;
+    }
+}
+
 void JsonReader::ReadStatRequests(transport::catalogue::TransportCatalogue& catalogue) {
-    router_.InitRouter();
+    // Переходы пешком добавляются в граф один раз, после того как известны все остановки
+    const RoutingSettings& settings = router_.GetSettings();
+    if (!walks_added_ && settings.walking_radius > 0 && settings.walking_speed > 0) {
+        for (const auto& [first, second, distance] : catalogue.FindNearbyStops(settings.walking_radius)) {
+            router_.AddWalk(first->id, second->id, distance);
+        }
+        walks_added_ = true;
+    }
+    router_.InitRouter(catalogue.GetStopCount());
+
+    const auto& stat = doc_.GetRoot().AsDict().at("stat_requests").AsArray();
+    vector<StatRequest> queries;
+    queries.reserve(stat.size());
+    for (const Node& request : stat) {
+        queries.push_back(ParseStatRequest(request.AsDict()));
+    }
+    vector<optional<Node>> batched = ProcessRouteBatches(queries, catalogue);
 
-    auto stat = doc_.GetRoot().AsDict().at("stat_requests").AsArray();
     Array result;
-    Node node(result);
-    for (Node request : stat) {
-        auto item = request.AsDict();
-        if (item.at("type").AsString() == "Bus") {
-            string name = item.at("name").AsString();
-            int id = item.at("id").AsInt();
-            auto bus_stat = catalogue.GetBusInfo(name);
-            if (bus_stat.has_value()) {
-                node.AsArray().emplace_back(Builder{}.StartDict().Key("request_id").Value(id)
-                        .Key("curvature").Value(bus_stat.value().curvature)
-                        .Key("route_length").Value(bus_stat.value().route_length)
-                        .Key("stop_count").Value(bus_stat.value().stop_count)
-                        .Key("unique_stop_count").Value(bus_stat.value().unique_stop_count).EndDict().Build().AsDict());
-            } else {
-                node.AsArray().emplace_back(Builder{}.StartDict().Key("request_id").Value(id)
-                        .Key("error_message").Value("not found"s).EndDict().Build().AsDict());
-            }
+    result.reserve(stat.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        if (batched[i]) {
+            result.push_back(move(*batched[i]));
+            continue;
         }
+        const StatRequest& query = queries[i];
+        switch (query.type) {
+            case RequestType::BUS:
+                result.push_back(ProcessBusRequest(get<BusQuery>(query.query), catalogue));
+                break;
+            case RequestType::STOP:
+                result.push_back(ProcessStopRequest(get<StopQuery>(query.query), catalogue));
+                break;
+            case RequestType::MAP:
+                result.push_back(ProcessMapRequest(get<MapQuery>(query.query), catalogue));
+                break;
+            case RequestType::ROUTE:
+                result.push_back(ProcessRouteRequest(get<RouteQuery>(query.query), catalogue));
+                break;
+            case RequestType::TILE:
+                result.push_back(ProcessTileRequest(get<TileQuery>(query.query), catalogue));
+                break;
+            case RequestType::MATRIX:
+                result.push_back(ProcessMatrixRequest(get<MatrixQuery>(query.query), catalogue));
+                break;
+            case RequestType::UNKNOWN:
+                break;
+        }
+    }
+    Node node(move(result));
+    if (output_format_ == Format::BINARY) {
+        PrintBinary(Document{move(node)}, cout);
+    } else {
+        Print(Document{move(node)}, cout);
+    }
+}
 
-        if (item.at("type").AsString() == "Stop") {
-            string name = item.at("name").AsString();
-            int id = item.at("id").AsInt();
-            Dict buses;
-            Array buses_list;
-            for (auto bus : catalogue.GetBusesByStop(name)) {
-                buses_list.push_back(Node(move(bus)));
-            }
-            if (buses_list.empty() && catalogue.FindStop(name) == nullptr) {
-                node.AsArray().emplace_back(Builder{}.StartDict().Key("error_message").Value("not found"s)
-                    .Key("request_id").Value(id).EndDict().Build().AsDict());
-            } else {
-                node.AsArray().emplace_back(Builder{}.StartDict().Key("buses").Value(buses_list)
-                                                    .Key("request_id").Value(id).EndDict().Build().AsDict());
+Node JsonReader::ProcessBusRequest(const BusQuery& query, transport::catalogue::TransportCatalogue& catalogue) {
+    auto bus_stat = catalogue.GetBusInfo(string(query.name));
+    if (bus_stat.has_value()) {
+        return Builder{}.StartDict().Key("request_id").Value(query.id)
+                .Key("curvature").Value(bus_stat.value().curvature)
+                .Key("route_length").Value(bus_stat.value().route_length)
+                .Key("stop_count").Value(bus_stat.value().stop_count)
+                .Key("unique_stop_count").Value(bus_stat.value().unique_stop_count).EndDict().Build();
+    }
+    return Builder{}.StartDict().Key("request_id").Value(query.id)
+            .Key("error_message").Value("not found"s).EndDict().Build();
+}
+
+Node JsonReader::ProcessStopRequest(const StopQuery& query, transport::catalogue::TransportCatalogue& catalogue) {
+    const string name(query.name);
+    Array buses_list;
+    for (auto bus : catalogue.GetBusesByStop(name)) {
+        buses_list.push_back(Node(move(bus)));
+    }
+    if (buses_list.empty() && catalogue.FindStop(name) == nullptr) {
+        return Builder{}.StartDict().Key("error_message").Value("not found"s)
+                .Key("request_id").Value(query.id).EndDict().Build();
+    }
+    return Builder{}.StartDict().Key("buses").Value(buses_list)
+            .Key("request_id").Value(query.id).EndDict().Build();
+}
+
+const RenderSettings& JsonReader::GetRenderSettings() {
+    if (!render_settings_) {
+        render_settings_ = ReadSettings();
+        render_settings_hash_ = HashRenderSettings(*render_settings_);
+    }
+    return *render_settings_;
+}
+
+const MapIndex& JsonReader::GetMapIndex(transport::catalogue::TransportCatalogue& catalogue) {
+    if (!map_index_ || map_index_version_ != catalogue.GetVersion()) {
+        map_index_.emplace(catalogue.GetRenderOrder());
+        map_index_version_ = catalogue.GetVersion();
+    }
+    return *map_index_;
+}
+
+Node JsonReader::ProcessMapRequest(const MapQuery& query, transport::catalogue::TransportCatalogue& catalogue) {
+    const RenderSettings& settings = GetRenderSettings();
+    if (query.viewport) {
+        ostringstream out;
+        MapRenderer renderer(catalogue.GetRenderOrder(), settings, out);
+        renderer.PrintViewport(GetMapIndex(catalogue), *query.viewport, query.zoom);
+        renderer.PrintMap();
+        return Builder{}.StartDict().Key("map").Value(out.str())
+                .Key("request_id").Value(query.id).EndDict().Build();
+    }
+    const string* map = map_cache_.Find(catalogue.GetVersion(), render_settings_hash_, settings);
+    if (map == nullptr) {
+        // Порядок вывода обновляется справочником на месте, поэтому отрисовщик продолжает ссылаться на него
+        const RenderOrder& order = catalogue.GetRenderOrder();
+        if (!map_renderer_ || map_renderer_settings_hash_ != render_settings_hash_ || map_renderer_order_ != &order) {
+            map_renderer_.emplace(order, settings, map_output_);
+            map_renderer_settings_hash_ = render_settings_hash_;
+            map_renderer_order_ = &order;
+        }
+        map_renderer_->UpdateFragments();
+        map_output_.str({});
+        map_renderer_->PrintFragments();
+        map_renderer_->PrintMap();
+        map = &map_cache_.Store(catalogue.GetVersion(), render_settings_hash_, settings, map_output_.str());
+    }
+    return Builder{}.StartDict().Key("map").Value(*map)
+            .Key("request_id").Value(query.id).EndDict().Build();
+}
+
+Node JsonReader::ProcessTileRequest(const TileQuery& query, transport::catalogue::TransportCatalogue& catalogue) {
+    if (!query.tile.IsValid()) {
+        return Builder{}.StartDict().Key("request_id").Value(query.id)
+                .Key("error_message").Value("not found"s).EndDict().Build();
+    }
+    const RenderSettings& settings = GetRenderSettings();
+    const uint64_t version = catalogue.GetVersion();
+    // Ключ тайлов пересчитывается только при изменении справочника или настроек
+    if (tile_key_source_ != pair{version, render_settings_hash_}) {
+        tile_key_ = HashNetwork(catalogue.GetRenderOrder(), render_settings_hash_);
+        tile_key_source_ = pair{version, render_settings_hash_};
+    }
+
+    const TileCache cache(settings.tile_cache_dir);
+    optional<string> path = cache.Find(version, tile_key_, query.tile);
+    if (!path) {
+        ostringstream out;
+        MapRenderer renderer(catalogue.GetRenderOrder(), settings, out);
+        renderer.InitSphere();
+        renderer.PrintTile(query.tile);
+        path = cache.Store(version, tile_key_, query.tile, out.str());
+    }
+    return Builder{}.StartDict().Key("tile").Value(move(*path))
+            .Key("request_id").Value(query.id).EndDict().Build();
+}
+
+Node JsonReader::ProcessMatrixRequest(const MatrixQuery& query, transport::catalogue::TransportCatalogue& catalogue) {
+    // Матрица считается только между известными остановками; строки и столбцы
+    // неизвестных остановок в ответе заполняются null
+    auto find_stops = [&catalogue](const vector<string_view>& names, vector<graph::VertexId>& stops) {
+        vector<optional<size_t>> index(names.size());
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (const Stop* stop = catalogue.FindStop(names[i])) {
+                index[i] = stops.size();
+                stops.push_back(stop->id);
             }
         }
+        return index;
+    };
+    vector<graph::VertexId> sources;
+    vector<graph::VertexId> targets;
+    const auto source_index = find_stops(query.origins, sources);
+    const auto target_index = find_stops(query.destinations, targets);
+
+    const auto matrix = router_.BuildMatrix(sources, targets);
+    Array times;
+    times.reserve(source_index.size() * target_index.size());
+    for (const auto& source : source_index) {
+        for (const auto& target : target_index) {
+            const auto& time = source && target ? matrix[*source * targets.size() + *target] : nullopt;
+            times.push_back(time ? Node(*time) : Node(nullptr));
+        }
+    }
+    // Словарь собирается без Builder: Build копирует построенный узел, а матрица может быть очень большой
+    Dict response;
+    response["request_id"] = query.id;
+    response["times"] = move(times);
+    return Node(move(response));
+}
 
-        if (item.at("type").AsString() == "Map") {
-            auto routes = catalogue.GetRoutes();
-            Dict map;
-            int id = item.at("id").AsInt();
-            map["request_id"] = id;
-            ostringstream out;
-
-            MapRenderer renderer(routes, ReadSettings(), out);
-            renderer.InitSphere();
-            renderer.PrintRoutes();
-            renderer.PrintBusText();
-            renderer.PrintStops() ;
-            renderer.PrintMap();
-            node.AsArray().emplace_back(Builder{}.StartDict().Key("map").Value(out.str())
-                .Key("request_id").Value(id).EndDict().Build().AsDict());
-
-        }
-
-        if (item.at("type").AsString() == "Route") {
-            int id = item.at("id").AsInt();
-            string from = item.at("from").AsString();
-            string to = item.at("to").AsString();
-            auto route = router_.BuildRoute(catalogue.GetId(from), catalogue.GetId(to));
-            if (!route.has_value()) {
-                node.AsArray().emplace_back(Builder{}.StartDict().Key("request_id").Value(id)
-                                                    .Key("error_message").Value("not found"s)
-                                                    .EndDict().Build().AsDict());
+const TimetableRouter& JsonReader::GetTimetableRouter(transport::catalogue::TransportCatalogue& catalogue) {
+    // Времена рейсов по отправлениям вычисляются по скорости из текущих настроек маршрутизации
+    const double bus_velocity = router_.GetSettings().bus_velocity;
+    if (!timetable_router_ || timetable_router_version_ != catalogue.GetVersion()
+        || timetable_router_velocity_ != bus_velocity) {
+        timetable_router_.emplace(catalogue.GetRoutes(), catalogue.GetStopCount(),
+                                  [&catalogue, bus_velocity](const Bus& bus, double departure) {
+                                      return catalogue.ComputeTripTimes(bus, departure, bus_velocity);
+                                  });
+        timetable_router_version_ = catalogue.GetVersion();
+        timetable_router_velocity_ = bus_velocity;
+    }
+    return *timetable_router_;
+}
+
+Node JsonReader::ProcessTimetableRouteRequest(const RouteQuery& query,
+                                              transport::catalogue::TransportCatalogue& catalogue) {
+    const Stop* from = catalogue.FindStop(query.from);
+    const Stop* to = catalogue.FindStop(query.to);
+    optional<TimetableRouter::Journey> journey;
+    if (from != nullptr && to != nullptr) {
+        journey = GetTimetableRouter(catalogue).BuildRoute(from->id, to->id, *query.departure_time);
+    }
+    if (!journey) {
+        return Builder{}.StartDict().Key("request_id").Value(query.id)
+                .Key("error_message").Value("not found"s)
+                .EndDict().Build();
+    }
+
+    Array items;
+    items.reserve(journey->legs.size() * 2);
+    for (const auto& leg : journey->legs) {
+        items.push_back(Builder{}.StartDict().Key("stop_name").Value(leg.board_stop->name)
+                .Key("time").Value(leg.wait_time)
+                .Key("type").Value("Wait"s)
+                .EndDict().Build());
+        items.push_back(Builder{}.StartDict().Key("bus").Value(leg.bus->name)
+                .Key("span_count").Value(static_cast<int>(leg.span_count))
+                .Key("time").Value(leg.ride_time)
+                .Key("type").Value("Bus"s)
+                .EndDict().Build());
+    }
+
+    return Builder{}.StartDict().Key("request_id").Value(query.id)
+            .Key("total_time").Value(journey->arrival_time - journey->departure_time)
+            .Key("items").Value(move(items))
+            .EndDict().Build();
+}
+
+Node JsonReader::ProcessRouteRequest(const RouteQuery& query, transport::catalogue::TransportCatalogue& catalogue) {
+    if (query.departure_time) {
+        return ProcessTimetableRouteRequest(query, catalogue);
+    }
+    if (catalogue.FindStop(query.from) == nullptr || catalogue.FindStop(query.to) == nullptr) {
+        return Builder{}.StartDict().Key("request_id").Value(query.id)
+                .Key("error_message").Value("not found"s)
+                .EndDict().Build();
+    }
+    if (query.pareto) {
+        return ProcessParetoRouteRequest(query, catalogue);
+    }
+    if (query.count) {
+        return ProcessAlternativeRouteRequest(query, catalogue);
+    }
+    const RoutingSettings settings = GetRouteSettings(query);
+    auto route = router_.BuildRoute(catalogue.GetId(string(query.from)), catalogue.GetId(string(query.to)), settings);
+    return MakeRouteAnswer(query.id, route, settings, catalogue);
+}
+
+RoutingSettings JsonReader::GetRouteSettings(const RouteQuery& query) const {
+    RoutingSettings settings = router_.GetSettings();
+    settings.bus_wait_time = query.bus_wait_time.value_or(settings.bus_wait_time);
+    settings.bus_velocity = query.bus_velocity.value_or(settings.bus_velocity);
+    return settings;
+}
+
+Node JsonReader::MakeRouteAnswer(int id, const optional<graph::Router<double>::RouteInfo>& route,
+                                 const RoutingSettings& settings,
+                                 const transport::catalogue::TransportCatalogue& catalogue) const {
+    if (!route.has_value()) {
+        return Builder{}.StartDict().Key("request_id").Value(id)
+                .Key("error_message").Value("not found"s)
+                .EndDict().Build();
+    }
+
+    return Builder{}.StartDict().Key("request_id").Value(id)
+            .Key("total_time").Value(route.value().weight)
+            .Key("items").Value(MakeRouteItems(route.value().edges, settings, catalogue))
+            .EndDict().Build();
+}
+
+vector<optional<Node>> JsonReader::ProcessRouteBatches(const vector<StatRequest>& queries,
+                                                       transport::catalogue::TransportCatalogue& catalogue) {
+    vector<optional<Node>> answers(queries.size());
+
+    // Кратчайшие маршруты, которые ищутся отдельным поиском, разбиваются по настройкам
+    struct Member {
+        size_t index;
+        graph::VertexId from;
+        graph::VertexId to;
+    };
+    vector<pair<RoutingSettings, vector<Member>>> batches;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        if (queries[i].type != RequestType::ROUTE) {
+            continue;
+        }
+        const RouteQuery& query = get<RouteQuery>(queries[i].query);
+        if (query.departure_time || query.pareto || query.count) {
+            continue;
+        }
+        const RoutingSettings settings = GetRouteSettings(query);
+        if (!router_.SearchesPerRoute(settings)) {
+            continue;
+        }
+        // Запросы с неизвестными остановками в группы не входят и обрабатываются как обычно
+        const Stop* from = catalogue.FindStop(query.from);
+        const Stop* to = catalogue.FindStop(query.to);
+        if (from == nullptr || to == nullptr) {
+            continue;
+        }
+        auto batch = find_if(batches.begin(), batches.end(), [&settings](const auto& item) {
+            return item.first == settings;
+        });
+        if (batch == batches.end()) {
+            batch = batches.insert(batches.end(), {settings, {}});
+        }
+        batch->second.push_back({i, from->id, to->id});
+    }
+
+    // Каждый запрос относится к той из групп - по началу или по концу маршрута, - которая больше.
+    // Для группы строится одно дерево маршрутов, прямое или обратное; запросы, оставшиеся
+    // в группе одни, ищутся как обычно
+    for (const auto& [settings, members] : batches) {
+        unordered_map<graph::VertexId, size_t> from_count;
+        unordered_map<graph::VertexId, size_t> to_count;
+        for (const Member& member : members) {
+            ++from_count[member.from];
+            ++to_count[member.to];
+        }
+        map<pair<bool, graph::VertexId>, vector<const Member*>> groups;
+        for (const Member& member : members) {
+            const bool reverse = to_count[member.to] > from_count[member.from];
+            groups[{reverse, reverse ? member.to : member.from}].push_back(&member);
+        }
+
+        for (const auto& [key, group] : groups) {
+            if (group.size() < 2) {
                 continue;
             }
-
-            Array items;
-            Dict dict;
-            int wait_time = catalogue.GetWait();
-
-            for (auto& edge_id : route.value().edges) {
-                auto edge = router_.GetGraph().GetEdge(edge_id);
-
-                dict = Builder{}.StartDict().Key("stop_name").Value(edge.stop_name)
-                        .Key("time").Value(wait_time)
-                        .Key("type").Value("Wait"s)
-                        .EndDict().Build().AsDict();
-                items.emplace_back(dict);
-
-                dict = Builder{}.StartDict().Key("bus").Value(edge.bus_name)
-                        .Key("span_count").Value(edge.num_stops)
-                        .Key("time").Value(edge.ride_time)
-                        .Key("type").Value("Bus"s)
-                        .EndDict().Build().AsDict();
-                items.emplace_back(dict);
+            const auto [reverse, root] = key;
+            vector<graph::VertexId> others;
+            others.reserve(group.size());
+            for (const Member* member : group) {
+                others.push_back(reverse ? member->from : member->to);
             }
+            const auto tree = router_.BuildRouteTree(root, reverse, settings, others);
+            for (size_t i = 0; i < group.size(); ++i) {
+                const int id = get<RouteQuery>(queries[group[i]->index].query).id;
+                answers[group[i]->index] = MakeRouteAnswer(id, router_.GetTreeRoute(tree, others[i]), settings, catalogue);
+            }
+        }
+    }
+    return answers;
+}
 
-            node.AsArray().emplace_back(Builder{}.StartDict().Key("request_id").Value(id)
-                    .Key("total_time").Value(route.value().weight)
-                    .Key("items").Value(items)
-                    .EndDict().Build().AsDict());
+Node JsonReader::ProcessParetoRouteRequest(const RouteQuery& query, transport::catalogue::TransportCatalogue& catalogue) {
+    const RoutingSettings settings = GetRouteSettings(query);
+    return MakeItineraries(query.id, router_.BuildParetoRoutes(catalogue.GetId(string(query.from)),
+                                                               catalogue.GetId(string(query.to)), settings,
+                                                               query.max_extra_time),
+                           settings, catalogue);
+}
+
+Node JsonReader::ProcessAlternativeRouteRequest(const RouteQuery& query, transport::catalogue::TransportCatalogue& catalogue) {
+    const RoutingSettings settings = GetRouteSettings(query);
+    const size_t count = static_cast<size_t>(max(*query.count, 1));
+    return MakeItineraries(query.id, router_.BuildAlternativeRoutes(catalogue.GetId(string(query.from)),
+                                                                    catalogue.GetId(string(query.to)), settings,
+                                                                    count, query.max_similarity),
+                           settings, catalogue);
+}
+
+template <typename Routes>
+Node JsonReader::MakeItineraries(int id, const Routes& routes, const RoutingSettings& settings,
+                                 const transport::catalogue::TransportCatalogue& catalogue) const {
+    if (routes.empty()) {
+        return Builder{}.StartDict().Key("request_id").Value(id)
+                .Key("error_message").Value("not found"s)
+                .EndDict().Build();
+    }
+
+    Array itineraries;
+    itineraries.reserve(routes.size());
+    for (const auto& route : routes) {
+        itineraries.push_back(Builder{}.StartDict().Key("items").Value(MakeRouteItems(route.edges, settings, catalogue))
+                .Key("total_time").Value(route.weight)
+                .EndDict().Build());
+    }
+    return Builder{}.StartDict().Key("itineraries").Value(move(itineraries))
+            .Key("request_id").Value(id)
+            .EndDict().Build();
+}
+
+Array JsonReader::MakeRouteItems(const vector<graph::EdgeId>& edges, const RoutingSettings& settings,
+                                 const transport::catalogue::TransportCatalogue& catalogue) const {
+    Array items;
+    items.reserve(edges.size() * 2);
+
+    for (const auto& edge_id : edges) {
+        const auto& edge = router_.GetGraph().GetEdge(edge_id);
+
+        if (edge.walk) {
+            items.push_back(Builder{}.StartDict().Key("from").Value(catalogue.GetStop(router_.GetStopId(edge.from)).name)
+                    .Key("time").Value(TransportRouter::GetRideTime(edge, settings))
+                    .Key("to").Value(catalogue.GetStop(router_.GetStopId(edge.to)).name)
+                    .Key("type").Value("Walk"s)
+                    .EndDict().Build());
+            continue;
         }
+
+        items.push_back(Builder{}.StartDict().Key("stop_name").Value(edge.stop_name)
+                .Key("time").Value(settings.bus_wait_time)
+                .Key("type").Value("Wait"s)
+                .EndDict().Build());
+
+        items.push_back(Builder{}.StartDict().Key("bus").Value(edge.bus_name)
+                .Key("span_count").Value(edge.num_stops)
+                .Key("time").Value(TransportRouter::GetRideTime(edge, settings))
+                .Key("type").Value("Bus"s)
+                .EndDict().Build());
     }
-    Document doc = Document{node};
-    Print(doc, cout);
+    return items;
 }
 
-svg::Color ReadNode(Node node) {
+svg::Color ReadNode(const Node& node) {
     if (node.IsString()) {
         return svg::Color(node.AsString());
     } else if (node.IsArray() && node.AsArray().size() == 3) {
@@ -1,10 +1,16 @@
 #pragma once
 
 #include "json.h"
+#include "json_binary.h"
 #include "map_renderer.h"
+#include <optional>
 #include "router.h"
 #include <sstream>
+#include <string_view>
+#include "timetable_router.h"
 #include "transport_catalogue.h"
+#include <variant>
+#include <vector>
 
 namespace json {
 
@@ -14,6 +20,8 @@ public:
 
     Node &GetRoot();
 
+    const Node &GetRoot() const;
+
     bool operator==(const Document &other) const;
 
     bool operator!=(const Document &other) const;
@@ -22,23 +30,152 @@ private:
     Node root_;
 };
 
+// Тип запроса к базе определяется один раз при разборе запроса
+enum class RequestType {
+    UNKNOWN,
+    BUS,
+    STOP,
+    MAP,
+    ROUTE,
+    TILE,
+    MATRIX,
+};
+
+// Строки запросов ссылаются на данные документа и живут, пока жив документ
+struct BusQuery {
+    int id = 0;
+    std::string_view name;
+};
+
+struct StopQuery {
+    int id = 0;
+    std::string_view name;
+};
+
+// Если задана область viewport, выводится только часть карты внутри неё
+struct MapQuery {
+    int id = 0;
+    std::optional<Viewport> viewport;
+    int zoom = 0;
+};
+
+// Если задано время отправления (в минутах от начала суток), маршрут ищется по расписанию.
+// При pareto ответ содержит все маршруты, недоминируемые по времени и числу поездок,
+// которые дольше самого быстрого не более чем на max_extra_time. Если задано count, ответ
+// содержит до count кратчайших маршрутов, похожих друг на друга не больше чем на max_similarity.
+// bus_wait_time и bus_velocity заменяют настройки маршрутизации для одного запроса (кроме поиска по расписанию)
+struct RouteQuery {
+    int id = 0;
+    std::string_view from;
+    std::string_view to;
+    std::optional<double> departure_time;
+    bool pareto = false;
+    std::optional<double> max_extra_time;
+    std::optional<int> count;
+    double max_similarity = 1.0;
+    std::optional<int> bus_wait_time;
+    std::optional<double> bus_velocity;
+};
+
+// Растровый тайл карты; в ответе - путь к файлу PNG в дисковом кэше тайлов
+struct TileQuery {
+    int id = 0;
+    Tile tile;
+};
+
+// Матрица времени маршрутов из каждой остановки origins в каждую остановку destinations;
+// в ответе - плоский список times по строкам, null - маршрута нет или остановки нет в справочнике
+struct MatrixQuery {
+    int id = 0;
+    std::vector<std::string_view> origins;
+    std::vector<std::string_view> destinations;
+};
+
+struct StatRequest {
+    RequestType type = RequestType::UNKNOWN;
+    std::variant<std::monostate, BusQuery, StopQuery, MapQuery, RouteQuery, TileQuery, MatrixQuery> query;
+};
+
+RequestType ParseRequestType(std::string_view type);
+
+// Разбирает запрос за один проход по его ключам
+StatRequest ParseStatRequest(const Dict& request);
+
 class JsonReader {
 public:
     explicit JsonReader(Document);
     void SetDoc(Document&&);
     Document& GetDoc();
-    RenderSettings ReadSettings();
-    void ReadRouterSettings(transport::catalogue::TransportCatalogue& catalogue);
+    const Document& GetDoc() const;
+    RenderSettings ReadSettings() const;
+    void ReadRouterSettings();
     void ReadBaseRequest(transport::catalogue::TransportCatalogue& catalogue);
     void ReadStatRequests(transport::catalogue::TransportCatalogue& catalogue);
+    void SetOutputFormat(Format format);
+    TransportRouter& GetRouter();
 
 private:
+    Node ProcessBusRequest(const BusQuery& query, transport::catalogue::TransportCatalogue& catalogue);
+    Node ProcessStopRequest(const StopQuery& query, transport::catalogue::TransportCatalogue& catalogue);
+    Node ProcessMapRequest(const MapQuery& query, transport::catalogue::TransportCatalogue& catalogue);
+    Node ProcessRouteRequest(const RouteQuery& query, transport::catalogue::TransportCatalogue& catalogue);
+    Node ProcessTileRequest(const TileQuery& query, transport::catalogue::TransportCatalogue& catalogue);
+    Node ProcessMatrixRequest(const MatrixQuery& query, transport::catalogue::TransportCatalogue& catalogue);
+    Node ProcessTimetableRouteRequest(const RouteQuery& query, transport::catalogue::TransportCatalogue& catalogue);
+    Node ProcessParetoRouteRequest(const RouteQuery& query, transport::catalogue::TransportCatalogue& catalogue);
+    Node ProcessAlternativeRouteRequest(const RouteQuery& query, transport::catalogue::TransportCatalogue& catalogue);
+    // Заранее отвечает на запросы кратчайшего маршрута с общим началом или концом одним деревом
+    // маршрутов на группу. Ответы лежат на местах запросов; nullopt - запрос обрабатывается как обычно
+    std::vector<std::optional<Node>> ProcessRouteBatches(const std::vector<StatRequest>& queries,
+                                                         transport::catalogue::TransportCatalogue& catalogue);
+    // Настройки маршрутизации с учётом переопределений в запросе
+    RoutingSettings GetRouteSettings(const RouteQuery& query) const;
+    Node MakeRouteAnswer(int id, const std::optional<graph::Router<double>::RouteInfo>& route,
+                         const RoutingSettings& settings, const transport::catalogue::TransportCatalogue& catalogue) const;
+    // Ответ с несколькими маршрутами: список itineraries, у каждого total_time и items
+    template <typename Routes>
+    Node MakeItineraries(int id, const Routes& routes, const RoutingSettings& settings,
+                         const transport::catalogue::TransportCatalogue& catalogue) const;
+    // Элементы Wait, Bus и Walk ответа Route для рёбер графа маршрутов
+    Array MakeRouteItems(const std::vector<graph::EdgeId>& edges, const RoutingSettings& settings,
+                         const transport::catalogue::TransportCatalogue& catalogue) const;
+    const RenderSettings& GetRenderSettings();
+    const MapIndex& GetMapIndex(transport::catalogue::TransportCatalogue& catalogue);
+    const TimetableRouter& GetTimetableRouter(transport::catalogue::TransportCatalogue& catalogue);
+
+
     Document doc_;
+    Format output_format_ = Format::TEXT;
+    // Настройки отрисовки читаются из документа один раз
+    std::optional<RenderSettings> render_settings_;
+    size_t render_settings_hash_ = 0;
+    MapCache map_cache_;
+    // Пространственный индекс для запросов части карты и версия справочника, для которой он построен
+    std::optional<MapIndex> map_index_;
+    uint64_t map_index_version_ = 0;
+    // Отрисовщик, хранящий фрагменты карты между версиями справочника: после изменения
+    // справочника заново выводятся только затронутые фрагменты
+    std::ostringstream map_output_;
+    std::optional<MapRenderer> map_renderer_;
+    size_t map_renderer_settings_hash_ = 0;
+    const RenderOrder* map_renderer_order_ = nullptr;
+    // Ключ кэша тайлов, а также версия справочника и хэш настроек, для которых он посчитан
+    size_t tile_key_ = 0;
+    std::optional<std::pair<uint64_t, size_t>> tile_key_source_;
     TransportRouter router_;
+    bool walks_added_ = false;
+    // Маршрутизатор по расписанию, а также версия справочника и скорость автобуса, для которых он построен
+    std::optional<TimetableRouter> timetable_router_;
+    uint64_t timetable_router_version_ = 0;
+    double timetable_router_velocity_ = 0;
 };
 
 Document Load(std::istream &input);
 
-void Print(Document &doc, std::ostream &output);
+void Print(const Document &doc, std::ostream &output);
+
+Document LoadBinary(std::istream &input);
+
+void PrintBinary(const Document &doc, std::ostream &output);
 
 } //namespace json
\ No newline at end of file
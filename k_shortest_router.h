@@ -0,0 +1,283 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+/*
+ * Поиск k кратчайших простых путей (без повторения вершин) алгоритмом Йена.
+ *
+ * Каждый следующий путь - это отклонение от уже найденного: общий начальный участок до вершины
+ * ответвления и кратчайший путь от неё до цели в графе без рёбер, по которым уже уходили найденные
+ * пути с тем же началом, и без вершин начального участка. Чтобы отклонения не стоили каждое
+ * по полному поиску, один раз строится дерево кратчайших путей до цели обратным Дейкстрой:
+ *   - если путь по дереву от вершины ответвления не задевает запрещённых рёбер и вершин,
+ *     он и есть искомый, и поиск не нужен;
+ *   - иначе расстояния дерева - допустимая и согласованная оценка снизу для A*, потому что
+ *     удаление рёбер расстояния только увеличивает.
+ *
+ * Похожесть пути на уже выбранный - доля его веса, приходящаяся на перегоны между теми же
+ * вершинами; пути, похожие на выбранные больше чем на max_similarity, пропускаются.
+ *
+ * Вес ребра - edge_weight(edge), по умолчанию хранящийся в графе.
+ */
+template <typename Weight, typename EdgeWeight = StoredEdgeWeight<Weight>>
+class KShortestRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    explicit KShortestRouter(const Graph& graph, EdgeWeight edge_weight = {});
+
+    struct RouteInfo {
+        Weight weight;
+        std::vector<EdgeId> edges;
+    };
+
+    // До count путей в порядке возрастания веса; первый - кратчайший.
+    // Пустой результат - цель недостижима
+    std::vector<RouteInfo> BuildRoutes(VertexId from, VertexId to, size_t count,
+                                       double max_similarity = 1.0) const;
+
+private:
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+    // Сколько путей просматривается на каждый возвращаемый, если похожие пути отбрасываются
+    static constexpr size_t CANDIDATES_PER_ROUTE = 8;
+
+    struct Candidate {
+        Weight weight;
+        std::vector<EdgeId> edges;
+
+        bool operator>(const Candidate& other) const {
+            return weight != other.weight ? weight > other.weight : edges > other.edges;
+        }
+    };
+
+    // Рабочие массивы одного запроса. Метки поиска A* сбрасываются сменой номера поиска
+    struct Workspace {
+        std::vector<std::optional<Weight>> distance_to_target;
+        std::vector<EdgeId> tree_edge;
+        std::vector<bool> banned_vertex;
+        std::vector<EdgeId> banned_edges;
+        std::vector<uint32_t> search_id;
+        std::vector<Weight> distance;
+        std::vector<EdgeId> prev_edge;
+        uint32_t current_search = 0;
+    };
+
+    void BuildTargetTree(VertexId to, Workspace& workspace) const;
+    std::optional<RouteInfo> FindSpur(VertexId spur, VertexId to, Workspace& workspace) const;
+    bool IsBanned(EdgeId edge_id, const Workspace& workspace) const;
+    double Similarity(const RouteInfo& route, const std::vector<RouteInfo>& accepted) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    EdgeWeight edge_weight_;
+};
+
+template <typename Weight, typename EdgeWeight>
+KShortestRouter<Weight, EdgeWeight>::KShortestRouter(const Graph& graph, EdgeWeight edge_weight)
+    : graph_(graph)
+    , edge_weight_(std::move(edge_weight)) {
+}
+
+template <typename Weight, typename EdgeWeight>
+void KShortestRouter<Weight, EdgeWeight>::BuildTargetTree(VertexId to, Workspace& workspace) const {
+    auto& distance = workspace.distance_to_target;
+    using Item = std::pair<Weight, VertexId>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<>> queue;
+    distance[to] = ZERO_WEIGHT;
+    queue.push({ZERO_WEIGHT, to});
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > *distance[vertex]) {
+            continue;
+        }
+        for (const EdgeId edge_id : graph_.GetIncomingEdges(vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Weight edge_weight = edge_weight_(edge);
+            if (edge_weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            const Weight candidate = weight + edge_weight;
+            if (!distance[edge.from] || candidate < *distance[edge.from]) {
+                distance[edge.from] = candidate;
+                workspace.tree_edge[edge.from] = edge_id;
+                queue.push({candidate, edge.from});
+            }
+        }
+    }
+}
+
+template <typename Weight, typename EdgeWeight>
+bool KShortestRouter<Weight, EdgeWeight>::IsBanned(EdgeId edge_id, const Workspace& workspace) const {
+    return workspace.banned_vertex[graph_.GetEdge(edge_id).to]
+           || std::find(workspace.banned_edges.begin(), workspace.banned_edges.end(), edge_id)
+              != workspace.banned_edges.end();
+}
+
+template <typename Weight, typename EdgeWeight>
+std::optional<typename KShortestRouter<Weight, EdgeWeight>::RouteInfo> KShortestRouter<Weight, EdgeWeight>::FindSpur(
+        VertexId spur, VertexId to, Workspace& workspace) const {
+    const auto& heuristic = workspace.distance_to_target;
+    if (!heuristic[spur]) {
+        return std::nullopt;
+    }
+
+    // Путь по дереву, если он не задевает запрещённого
+    RouteInfo route{ZERO_WEIGHT, {}};
+    bool tree_path = true;
+    for (VertexId vertex = spur; vertex != to; vertex = graph_.GetEdge(workspace.tree_edge[vertex]).to) {
+        if (IsBanned(workspace.tree_edge[vertex], workspace)) {
+            tree_path = false;
+            break;
+        }
+        route.edges.push_back(workspace.tree_edge[vertex]);
+    }
+    if (tree_path) {
+        route.weight = *heuristic[spur];
+        return route;
+    }
+
+    // A* с расстояниями дерева в качестве оценки
+    const uint32_t search = ++workspace.current_search;
+    using Item = std::pair<Weight, VertexId>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<>> queue;
+    workspace.search_id[spur] = search;
+    workspace.distance[spur] = ZERO_WEIGHT;
+    workspace.prev_edge[spur] = NO_EDGE;
+    queue.push({*heuristic[spur], spur});
+    while (!queue.empty()) {
+        const auto [estimate, vertex] = queue.top();
+        queue.pop();
+        const Weight weight = workspace.distance[vertex];
+        if (estimate > weight + *heuristic[vertex]) {
+            continue;
+        }
+        if (vertex == to) {
+            route.weight = weight;
+            route.edges.clear();
+            for (EdgeId edge_id = workspace.prev_edge[to]; edge_id != NO_EDGE;
+                 edge_id = workspace.prev_edge[graph_.GetEdge(edge_id).from]) {
+                route.edges.push_back(edge_id);
+            }
+            std::reverse(route.edges.begin(), route.edges.end());
+            return route;
+        }
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            if (!heuristic[edge.to] || IsBanned(edge_id, workspace)) {
+                continue;
+            }
+            const Weight candidate = weight + edge_weight_(edge);
+            if (workspace.search_id[edge.to] != search || candidate < workspace.distance[edge.to]) {
+                workspace.search_id[edge.to] = search;
+                workspace.distance[edge.to] = candidate;
+                workspace.prev_edge[edge.to] = edge_id;
+                queue.push({candidate + *heuristic[edge.to], edge.to});
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+template <typename Weight, typename EdgeWeight>
+double KShortestRouter<Weight, EdgeWeight>::Similarity(const RouteInfo& route, const std::vector<RouteInfo>& accepted) const {
+    if (!(ZERO_WEIGHT < route.weight)) {
+        return 0.0;
+    }
+    double max_similarity = 0.0;
+    for (const RouteInfo& other : accepted) {
+        std::set<std::pair<VertexId, VertexId>> segments;
+        for (const EdgeId edge_id : other.edges) {
+            segments.emplace(graph_.GetEdge(edge_id).from, graph_.GetEdge(edge_id).to);
+        }
+        Weight shared = ZERO_WEIGHT;
+        for (const EdgeId edge_id : route.edges) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            if (segments.count({edge.from, edge.to}) > 0) {
+                shared = shared + edge_weight_(edge);
+            }
+        }
+        max_similarity = std::max(max_similarity, static_cast<double>(shared) / static_cast<double>(route.weight));
+    }
+    return max_similarity;
+}
+
+template <typename Weight, typename EdgeWeight>
+std::vector<typename KShortestRouter<Weight, EdgeWeight>::RouteInfo> KShortestRouter<Weight, EdgeWeight>::BuildRoutes(
+        VertexId from, VertexId to, size_t count, double max_similarity) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    Workspace workspace;
+    workspace.distance_to_target.resize(vertex_count);
+    workspace.tree_edge.assign(vertex_count, NO_EDGE);
+    workspace.banned_vertex.assign(vertex_count, false);
+    workspace.search_id.assign(vertex_count, 0);
+    workspace.distance.resize(vertex_count);
+    workspace.prev_edge.assign(vertex_count, NO_EDGE);
+
+    std::vector<RouteInfo> accepted;
+    BuildTargetTree(to, workspace);
+    std::optional<RouteInfo> first = count > 0 ? FindSpur(from, to, workspace) : std::nullopt;
+    if (!first) {
+        return accepted;
+    }
+
+    // found - все пути в порядке Йена, accepted - те из них, что не слишком похожи на выбранные ранее
+    std::vector<RouteInfo> found{*first};
+    accepted.push_back(std::move(*first));
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<>> candidates;
+    std::set<std::vector<EdgeId>> seen{found.front().edges};
+    const size_t max_found = count * CANDIDATES_PER_ROUTE;
+
+    while (accepted.size() < count && found.size() < max_found) {
+        const RouteInfo& last = found.back();
+        Weight root_weight = ZERO_WEIGHT;
+        VertexId spur = from;
+        for (size_t i = 0; i < last.edges.size(); ++i) {
+            // Запрещаются рёбра, по которым из spur уходят найденные пути с тем же началом
+            workspace.banned_edges.clear();
+            for (const RouteInfo& route : found) {
+                if (route.edges.size() > i && std::equal(last.edges.begin(), last.edges.begin() + i, route.edges.begin())) {
+                    workspace.banned_edges.push_back(route.edges[i]);
+                }
+            }
+            if (auto spur_route = FindSpur(spur, to, workspace)) {
+                std::vector<EdgeId> edges(last.edges.begin(), last.edges.begin() + i);
+                edges.insert(edges.end(), spur_route->edges.begin(), spur_route->edges.end());
+                if (seen.insert(edges).second) {
+                    candidates.push({root_weight + spur_route->weight, std::move(edges)});
+                }
+            }
+            // Вершина ответвления входит в начальный участок следующих отклонений
+            workspace.banned_vertex[spur] = true;
+            const auto& edge = graph_.GetEdge(last.edges[i]);
+            root_weight = root_weight + edge_weight_(edge);
+            spur = edge.to;
+        }
+        std::fill(workspace.banned_vertex.begin(), workspace.banned_vertex.end(), false);
+
+        if (candidates.empty()) {
+            break;
+        }
+        found.push_back({candidates.top().weight, candidates.top().edges});
+        candidates.pop();
+        if (max_similarity >= 1.0 || Similarity(found.back(), accepted) <= max_similarity) {
+            accepted.push_back(found.back());
+        }
+    }
+    return accepted;
+}
+
+}  // namespace graph
@@ -1,18 +1,56 @@
 #include <iostream>
+#include "input_reader.h"
 #include "json_reader.h"
 #include "graph.h"
 #include "router.h"
+#include <string>
+#include <string_view>
 
 using namespace std;
 
-int main() {
+// Флаги командной строки:
+//   --binary-input   запросы читаются в бинарном формате (см. json_binary.h)
+//   --binary-output  ответы выводятся в бинарном формате
+//   --to-binary      только перевести JSON-документ из cin в бинарный формат
+//   --text-base=FILE базу брать из файла в старом текстовом формате вместо base_requests
+int main(int argc, char* argv[]) {
+    json::Format input_format = json::Format::TEXT;
+    json::Format output_format = json::Format::TEXT;
+    bool convert_only = false;
+    string text_base;
+    for (int i = 1; i < argc; ++i) {
+        const string_view arg = argv[i];
+        if (arg == "--binary-input"sv) {
+            input_format = json::Format::BINARY;
+        } else if (arg == "--binary-output"sv) {
+            output_format = json::Format::BINARY;
+        } else if (arg == "--to-binary"sv) {
+            convert_only = true;
+        } else if (arg.substr(0, 12) == "--text-base="sv) {
+            text_base = string(arg.substr(12));
+        } else {
+            cerr << "Unknown option: "sv << arg << endl;
+            return 1;
+        }
+    }
+
+    if (convert_only) {
+        json::PrintBinary(json::Load(cin), cout);
+        return 0;
+    }
+
     transport::catalogue::TransportCatalogue catalogue;
 
-    json::JsonReader reader(move(json::Load(cin)));
+    json::JsonReader reader(input_format == json::Format::BINARY ? json::LoadBinary(cin) : json::Load(cin));
+    reader.SetOutputFormat(output_format);
 
     reader.ReadSettings();
-    reader.ReadRouterSettings(catalogue);
-    reader.ReadBaseRequest(catalogue);
+    reader.ReadRouterSettings();
+    if (text_base.empty()) {
+        reader.ReadBaseRequest(catalogue);
+    } else {
+        transport::input::InputReader(catalogue, reader.GetRouter()).ReadFile(text_base);
+    }
     reader.ReadStatRequests(catalogue);
 
 //    graph::DirectedWeightedGraph<double> routes_graph(5);
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "graph.h"
+#include "radix_heap.h"
+
+#include <algorithm>
+#include <future>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+/*
+ * Матрица кратчайших расстояний между списком начальных и списком конечных вершин.
+ *
+ * Каждая строка матрицы - отдельный поиск Дейкстры из начальной вершины, который
+ * останавливается, как только извлечены все конечные вершины. Строки независимы и считаются
+ * параллельно частями по числу потоков; у каждой части свои рабочие массивы, которые между
+ * поисками сбрасываются только в просмотренных вершинах.
+ *
+ * Поиски идут не по рёбрам графа, а по их сжатой копии: исходящие дуги вершины лежат подряд
+ * и хранят только конец и вес, а из параллельных рёбер (разные автобусы между теми же
+ * остановками) остаётся самое лёгкое. Это уменьшает и число дуг, и объём читаемой памяти.
+ * При целых беззнаковых весах очередь поиска - монотонная RadixHeap вместо двоичной кучи.
+ *
+ * Алгоритм с корзинами (bucket many-to-many) выигрывает лишь на графе с иерархией сокращений,
+ * где поиски от целей малы. В графе справочника обратный поиск от цели просматривает почти
+ * весь граф, и корзины заняли бы память порядка (число целей) x (число вершин).
+ */
+template <typename Weight>
+class ManyToManyRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    explicit ManyToManyRouter(const Graph& graph);
+
+    // Матрица по строкам: элемент [i * targets.size() + j] - расстояние от sources[i] до targets[j],
+    // nullopt - targets[j] из sources[i] недостижима
+    std::vector<std::optional<Weight>> BuildMatrix(const std::vector<VertexId>& sources,
+                                                   const std::vector<VertexId>& targets) const;
+
+private:
+    // Меньше строк на поток не выделяется: запуск потока дороже нескольких поисков
+    static constexpr size_t MIN_ROWS_PER_THREAD = 16;
+
+    struct Arc {
+        VertexId to;
+        Weight weight;
+    };
+
+    struct Workspace {
+        std::vector<std::optional<Weight>> distance;
+        std::vector<VertexId> touched;
+    };
+
+    void FillRow(VertexId source, const std::vector<VertexId>& targets, const std::vector<bool>& is_target,
+                 size_t target_count, Workspace& workspace, std::optional<Weight>* row) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    // Дуги вершины v: arcs_[arcs_begin_[v] .. arcs_begin_[v + 1])
+    std::vector<size_t> arcs_begin_;
+    std::vector<Arc> arcs_;
+};
+
+template <typename Weight>
+ManyToManyRouter<Weight>::ManyToManyRouter(const Graph& graph)
+    : arcs_begin_(graph.GetVertexCount() + 1, 0) {
+    std::vector<Arc> vertex_arcs;
+    for (VertexId vertex = 0; vertex < graph.GetVertexCount(); ++vertex) {
+        vertex_arcs.clear();
+        for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
+            const auto& edge = graph.GetEdge(edge_id);
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            vertex_arcs.push_back({edge.to, edge.weight});
+        }
+        std::sort(vertex_arcs.begin(), vertex_arcs.end(), [](const Arc& lhs, const Arc& rhs) {
+            return lhs.to != rhs.to ? lhs.to < rhs.to : lhs.weight < rhs.weight;
+        });
+        for (const Arc& arc : vertex_arcs) {
+            if (arcs_.size() == arcs_begin_[vertex] || arcs_.back().to != arc.to) {
+                arcs_.push_back(arc);
+            }
+        }
+        arcs_begin_[vertex + 1] = arcs_.size();
+    }
+}
+
+template <typename Weight>
+void ManyToManyRouter<Weight>::FillRow(VertexId source, const std::vector<VertexId>& targets,
+                                       const std::vector<bool>& is_target, size_t target_count,
+                                       Workspace& workspace, std::optional<Weight>* row) const {
+    auto& distance = workspace.distance;
+    using Item = std::pair<Weight, VertexId>;
+    std::conditional_t<std::is_integral_v<Weight> && std::is_unsigned_v<Weight>, RadixHeap<Weight, VertexId>,
+                       std::priority_queue<Item, std::vector<Item>, std::greater<>>> queue;
+    distance[source] = ZERO_WEIGHT;
+    workspace.touched.push_back(source);
+    queue.push({ZERO_WEIGHT, source});
+    size_t remaining = target_count;
+    while (!queue.empty() && remaining > 0) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > *distance[vertex]) {
+            continue;
+        }
+        // Вершина попадает в очередь только при строгом улучшении, поэтому извлекается с итоговым весом один раз
+        if (is_target[vertex]) {
+            --remaining;
+        }
+        for (size_t i = arcs_begin_[vertex]; i < arcs_begin_[vertex + 1]; ++i) {
+            const Arc& arc = arcs_[i];
+            const Weight candidate = weight + arc.weight;
+            if (!distance[arc.to]) {
+                workspace.touched.push_back(arc.to);
+            } else if (!(candidate < *distance[arc.to])) {
+                continue;
+            }
+            distance[arc.to] = candidate;
+            queue.push({candidate, arc.to});
+        }
+    }
+
+    for (size_t i = 0; i < targets.size(); ++i) {
+        row[i] = distance[targets[i]];
+    }
+    for (const VertexId vertex : workspace.touched) {
+        distance[vertex].reset();
+    }
+    workspace.touched.clear();
+}
+
+template <typename Weight>
+std::vector<std::optional<Weight>> ManyToManyRouter<Weight>::BuildMatrix(const std::vector<VertexId>& sources,
+                                                                         const std::vector<VertexId>& targets) const {
+    const size_t vertex_count = arcs_begin_.size() - 1;
+    std::vector<bool> is_target(vertex_count, false);
+    size_t target_count = 0;
+    for (const VertexId target : targets) {
+        if (!is_target.at(target)) {
+            is_target[target] = true;
+            ++target_count;
+        }
+    }
+    for (const VertexId source : sources) {
+        if (source >= vertex_count) {
+            throw std::out_of_range("Source vertex is out of range");
+        }
+    }
+
+    std::vector<std::optional<Weight>> matrix(sources.size() * targets.size());
+    const size_t chunk_count = std::clamp<size_t>(sources.size() / MIN_ROWS_PER_THREAD, 1,
+                                                  std::max(1u, std::thread::hardware_concurrency()));
+    const auto policy = chunk_count > 1 ? std::launch::async : std::launch::deferred;
+    std::vector<std::future<void>> parts;
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+        const size_t first = sources.size() * chunk / chunk_count;
+        const size_t last = sources.size() * (chunk + 1) / chunk_count;
+        parts.push_back(std::async(policy, [&, first, last] {
+            Workspace workspace;
+            workspace.distance.resize(vertex_count);
+            for (size_t i = first; i < last; ++i) {
+                FillRow(sources[i], targets, is_target, target_count, workspace, matrix.data() + i * targets.size());
+            }
+        }));
+    }
+    for (auto& part : parts) {
+        part.get();
+    }
+    return matrix;
+}
+
+}  // namespace graph
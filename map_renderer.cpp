@@ -1,8 +1,15 @@
 #include <algorithm>
 #include "map_renderer.h"
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <future>
 #include <ostream>
-#include <unordered_set>
-#include <set>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
 
 /*
  * В этом файле вы можете разместить код, отвечающий за визуализацию карты маршрутов в формате SVG.
@@ -12,104 +19,827 @@
 
 using namespace std;
 
-void MapRenderer::InitSphere() {
-    unordered_set<transport::geo::Coordinates, transport::geo::CoordinatesHasher> points;
-    for (auto& [name, bus] : buses_map_) {
-        for (auto& stop : bus.stop_names) {
-            points.insert(stop->coord);
+namespace {
+
+// Минимум и максимум массива. Четыре независимых накопителя без ветвлений
+// компилятор разворачивает в векторные min/max
+pair<double, double> MinMax(const vector<double>& values) {
+    static const size_t LANES = 4;
+    double min_lane[LANES];
+    double max_lane[LANES];
+    fill(begin(min_lane), end(min_lane), values.front());
+    fill(begin(max_lane), end(max_lane), values.front());
+    const size_t size = values.size();
+    size_t i = 0;
+    for (; i + LANES <= size; i += LANES) {
+        for (size_t lane = 0; lane < LANES; ++lane) {
+            const double value = values[i + lane];
+            min_lane[lane] = value < min_lane[lane] ? value : min_lane[lane];
+            max_lane[lane] = value > max_lane[lane] ? value : max_lane[lane];
         }
     }
-    sphere_ = SphereProjector(points.begin(), points.end(), settings_.width, settings_.height, settings_.padding);
+    for (; i < size; ++i) {
+        min_lane[0] = values[i] < min_lane[0] ? values[i] : min_lane[0];
+        max_lane[0] = values[i] > max_lane[0] ? values[i] : max_lane[0];
+    }
+    return {*min_element(begin(min_lane), end(min_lane)), *max_element(begin(max_lane), end(max_lane))};
+}
+
+}  // namespace
+
+SphereProjector::SphereProjector(const vector<double>& lats, const vector<double>& lngs,
+                                 double max_width, double max_height, double padding)
+        : padding_(padding) {
+    if (lats.empty()) {
+        return;
+    }
+    const auto [min_lat, max_lat] = MinMax(lats);
+    const auto [min_lon, max_lon] = MinMax(lngs);
+    SetBounds(min_lat, max_lat, min_lon, max_lon, max_width, max_height);
 }
 
-void MapRenderer::PrintRoutes() {
-    for (auto& [name, bus] : buses_map_) {
-        svg::Polyline line;
-        line.SetStrokeColor(settings_.nextColor()).SetFillColor(svg::NoneColor).SetStrokeWidth(settings_.line_width)
-                .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-                .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+void SphereProjector::Project(const double* lats, const double* lngs, size_t size, svg::Point* out) const {
+    for (size_t i = 0; i < size; ++i) {
+        out[i].x = (lngs[i] - min_lon_) * zoom_coeff_ + padding_;
+        out[i].y = (max_lat_ - lats[i]) * zoom_coeff_ + padding_;
+    }
+}
+
+void MapRenderer::InitSphere() {
+    // Обслуживаемые остановки в порядке вывода уже не повторяются
+    const size_t count = order_.stops.size();
+    vector<double> lats(count);
+    vector<double> lngs(count);
+    size_t max_id = 0;
+    for (size_t i = 0; i < count; ++i) {
+        lats[i] = order_.stops[i]->coord.lat;
+        lngs[i] = order_.stops[i]->coord.lng;
+        max_id = std::max(max_id, order_.stops[i]->id);
+    }
+    sphere_ = SphereProjector(lats, lngs, settings_.width, settings_.height, settings_.padding);
+
+    vector<svg::Point> points(count);
+    sphere_.Project(lats.data(), lngs.data(), count, points.data());
+    stop_points_.assign(count > 0 ? max_id + 1 : 0, svg::Point());
+    for (size_t i = 0; i < count; ++i) {
+        stop_points_[order_.stops[i]->id] = points[i];
+    }
+}
+
+svg::Point MapRenderer::StopPoint(const Stop* stop) const {
+    return stop->id < stop_points_.size() ? stop_points_[stop->id] : sphere_(stop->coord);
+}
+
+svg::Writer MapRenderer::MakeWriter() const {
+    return svg::Writer(settings_.compact_svg, settings_.compact_svg_precision);
+}
+
+template <typename Target>
+vector<svg::Writer::StyleId> MapRenderer::AddRouteStyles(Target& writer) const {
+    vector<svg::Writer::StyleId> styles;
+    for (const auto& color : settings_.color_palette) {
+        styles.push_back(writer.AddPathStyle({svg::NoneColor, color, settings_.line_width,
+                                               svg::StrokeLineCap::ROUND, svg::StrokeLineJoin::ROUND}));
+    }
+    return styles;
+}
+
+template <typename Target>
+MapRenderer::LabelStyles MapRenderer::AddBusLabelStyles(Target& writer) const {
+    const svg::Point offset(settings_.bus_label_offset.first, settings_.bus_label_offset.second);
+    const auto size = static_cast<uint32_t>(settings_.bus_label_font_size);
+    LabelStyles styles;
+    styles.underlayer = writer.AddTextStyle({offset, size, "Verdana", "bold",
+            {settings_.underlayer_color, settings_.underlayer_color, settings_.underlayer_width,
+             svg::StrokeLineCap::ROUND, svg::StrokeLineJoin::ROUND}});
+    for (const auto& color : settings_.color_palette) {
+        styles.fill.push_back(writer.AddTextStyle({offset, size, "Verdana", "bold", svg::PathStyle::Fill(color)}));
+    }
+    return styles;
+}
+
+template <typename Target>
+MapRenderer::LabelStyles MapRenderer::AddStopLabelStyles(Target& writer) const {
+    const svg::Point offset(settings_.stop_label_offset.first, settings_.stop_label_offset.second);
+    const auto size = static_cast<uint32_t>(settings_.stop_label_font_size);
+    LabelStyles styles;
+    styles.underlayer = writer.AddTextStyle({offset, size, "Verdana", "",
+            {settings_.underlayer_color, settings_.underlayer_color, settings_.underlayer_width,
+             svg::StrokeLineCap::ROUND, svg::StrokeLineJoin::ROUND}});
+    styles.fill.push_back(writer.AddTextStyle({offset, size, "Verdana", "", svg::PathStyle::Fill(svg::Color("black"))}));
+    return styles;
+}
+
+template <typename Target>
+void MapRenderer::PrintRoute(Target& writer, const Bus& bus, svg::Writer::StyleId style) const {
+    writer.BeginPolyline();
+    if (settings_.route_simplify_tolerance <= 0) {
         for (auto& point : bus.stop_names) {
-            line.AddPoint(sphere_(point->coord));
+            writer.AddPolylinePoint(StopPoint(point));
+        }
+    } else {
+        // Обратный путь некольцевого маршрута повторяет прямой и на рисунке не виден
+        const size_t count = bus.round_route || bus.stop_names.empty()
+                             ? bus.stop_names.size() : bus.stop_names.size() / 2 + 1;
+        vector<svg::Point> points;
+        points.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            points.push_back(StopPoint(bus.stop_names[i]));
+        }
+        for (const auto& point : SimplifyPolyline(points, settings_.route_simplify_tolerance)) {
+            writer.AddPolylinePoint(point);
+        }
+    }
+    writer.EndPolyline(style);
+}
+
+template <typename Target>
+void MapRenderer::PrintBusLabels(Target& writer, const Bus& bus, const BusTerminals& terminals,
+                                 svg::Writer::StyleId underlayer, svg::Writer::StyleId style,
+                                 const Viewport* viewport) const {
+    for (size_t i = 0; i < terminals.count; ++i) {
+        const Stop* stop = bus.stop_names[terminals.index[i]];
+        if (viewport != nullptr && !viewport->Contains(stop->coord)) {
+            continue;
         }
-        doc_.Add(line);
+        const svg::Point point = StopPoint(stop);
+        writer.AddText(point, bus.name, underlayer);
+        writer.AddText(point, bus.name, style);
+    }
+}
+
+void MapRenderer::PrintMap() {
+    writer_.Render(out_);
+}
+
+namespace {
+
+// Число частей, на которые делится работа данного объёма при параллельной отрисовке.
+// Мелкие карты быстрее отрисовать в текущем потоке, чем запускать потоки
+size_t ChunkCount(size_t work) {
+    static const size_t MIN_CHUNK_WORK = 4096;
+    return std::clamp<size_t>(work / MIN_CHUNK_WORK, 1, std::max(1u, thread::hardware_concurrency()));
+}
+
+// Вызывает task(i) для каждого i из [0, size), разбивая диапазон на chunk_count частей,
+// которые выполняются параллельно
+template <typename Task>
+void ParallelFor(size_t size, size_t chunk_count, Task task) {
+    const auto policy = chunk_count > 1 ? launch::async : launch::deferred;
+    vector<future<void>> parts;
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+        const size_t first = size * chunk / chunk_count;
+        const size_t last = size * (chunk + 1) / chunk_count;
+        parts.push_back(async(policy, [first, last, &task] {
+            for (size_t i = first; i < last; ++i) {
+                task(i);
+            }
+        }));
+    }
+    for (auto& part : parts) {
+        part.get();
     }
-    settings_.reset();
 }
 
-void MapRenderer::PrintBusText() {
-    for (auto& [name, bus] : buses_map_) {
-        if (bus.stop_names.empty()) {
+// Стиль цвета палитры с данным номером; пустая палитра приводит к out_of_range, как и nextColor
+svg::Writer::StyleId PaletteStyle(const vector<svg::Writer::StyleId>& styles, size_t index) {
+    return styles.at(styles.empty() ? 0 : index % styles.size());
+}
+
+// Отсекает отрезок from-to прямоугольником [min, max] (алгоритм Лианга - Барски).
+// Сообщает, были ли обрезаны начало и конец отрезка
+bool ClipSegment(svg::Point& from, svg::Point& to, svg::Point min, svg::Point max,
+                 bool& clipped_start, bool& clipped_end) {
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    const double p[] = {-dx, dx, -dy, dy};
+    const double q[] = {from.x - min.x, max.x - from.x, from.y - min.y, max.y - from.y};
+    double t0 = 0;
+    double t1 = 1;
+    for (int i = 0; i < 4; ++i) {
+        if (p[i] == 0) {
+            if (q[i] < 0) {
+                return false;
+            }
             continue;
         }
-        svg::Text text1;
-        svg::Text text2;
-        svg::Color color = settings_.nextColor();
-        auto& point1 = bus.stop_names[0];
-        text1.SetFontSize(settings_.bus_label_font_size).SetFontFamily("Verdana").SetFontWeight("bold")
-                .SetData(name).SetFillColor(settings_.underlayer_color).SetStrokeColor(settings_.underlayer_color)
-                .SetStrokeWidth(settings_.underlayer_width).SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-                .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND).SetPosition(sphere_(point1->coord))
-                .SetOffset(svg::Point(settings_.bus_label_offset.first, settings_.bus_label_offset.second));
-        text2.SetFontSize(settings_.bus_label_font_size).SetFontFamily("Verdana").SetFontWeight("bold")
-                .SetData(name).SetPosition(sphere_(point1->coord)).SetFillColor(color)
-                .SetOffset(svg::Point(settings_.bus_label_offset.first, settings_.bus_label_offset.second));
-        doc_.Add(text1);
-        doc_.Add(text2);
-
-        if (!bus.round_route && bus.stop_names.size() > 1
-            && bus.stop_names[bus.stop_names.size() / 2]->name != bus.stop_names[0]->name) {
-            auto& point2 = bus.stop_names[bus.stop_names.size() / 2];
-            text1.SetFontSize(settings_.bus_label_font_size).SetFontFamily("Verdana").SetFontWeight("bold")
-                    .SetData(name).SetFillColor(settings_.underlayer_color).SetStrokeColor(settings_.underlayer_color)
-                    .SetStrokeWidth(settings_.underlayer_width).SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-                    .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND).SetPosition(sphere_(point2->coord))
-                    .SetOffset(svg::Point(settings_.bus_label_offset.first, settings_.bus_label_offset.second));
-            text2.SetFontSize(settings_.bus_label_font_size).SetFontFamily("Verdana").SetFontWeight("bold")
-                    .SetData(name).SetPosition(sphere_(point2->coord)).SetFillColor(color)
-                    .SetOffset(svg::Point(settings_.bus_label_offset.first, settings_.bus_label_offset.second));
-            doc_.Add(text1);
-            doc_.Add(text2);
-        }
-    }
-}
-
-void MapRenderer::PrintStops() {
-    auto cmp = [](Stop* a, Stop* b) {
-        return a->name < b->name;
+        const double t = q[i] / p[i];
+        if (p[i] < 0) {
+            if (t > t1) {
+                return false;
+            }
+            t0 = std::max(t0, t);
+        } else {
+            if (t < t0) {
+                return false;
+            }
+            t1 = std::min(t1, t);
+        }
+    }
+    const svg::Point start = from;
+    clipped_start = t0 > 0;
+    clipped_end = t1 < 1;
+    if (clipped_start) {
+        from = {start.x + t0 * dx, start.y + t0 * dy};
+    }
+    if (clipped_end) {
+        to = {start.x + t1 * dx, start.y + t1 * dy};
+    }
+    return true;
+}
+
+}  // namespace
+
+void MapRenderer::PrintViewport(const MapIndex& index, const Viewport& viewport, int zoom) {
+    const transport::geo::Coordinates corners[] = {{viewport.min_lat, viewport.min_lng},
+                                                   {viewport.max_lat, viewport.max_lng}};
+    sphere_ = SphereProjector(begin(corners), end(corners), settings_.width, settings_.height, settings_.padding);
+    stop_points_.clear();
+    const svg::Point clip_min = sphere_({viewport.max_lat, viewport.min_lng});
+    const svg::Point clip_max = sphere_({viewport.min_lat, viewport.max_lng});
+    const auto& buses = index.GetBuses();
+
+    // Соседние видимые отрезки одного автобуса объединяются в одну ломаную
+    const auto route_styles = AddRouteStyles(writer_);
+    bool open = false;
+    size_t open_bus = 0;
+    size_t next_segment = 0;
+    for (const auto& segment : index.FindSegments(viewport)) {
+        const Bus& bus = *buses[segment.bus];
+        svg::Point from = StopPoint(bus.stop_names[segment.index]);
+        svg::Point to = StopPoint(bus.stop_names[segment.index + 1]);
+        bool clipped_start = false;
+        bool clipped_end = false;
+        if (!ClipSegment(from, to, clip_min, clip_max, clipped_start, clipped_end)) {
+            continue;
+        }
+        if (!open || open_bus != segment.bus || next_segment != segment.index || clipped_start) {
+            if (open) {
+                writer_.EndPolyline(PaletteStyle(route_styles, open_bus));
+            }
+            writer_.BeginPolyline();
+            writer_.AddPolylinePoint(from);
+            open = true;
+            open_bus = segment.bus;
+        }
+        writer_.AddPolylinePoint(to);
+        next_segment = segment.index + 1;
+        if (clipped_end) {
+            writer_.EndPolyline(PaletteStyle(route_styles, open_bus));
+            open = false;
+        }
+    }
+    if (open) {
+        writer_.EndPolyline(PaletteStyle(route_styles, open_bus));
+    }
+
+    // Цвета названий автобусов нумеруются только по автобусам с остановками, как на полной карте
+    const auto bus_styles = AddBusLabelStyles(writer_);
+    size_t color_index = 0;
+    const auto& terminals = index.GetTerminals();
+    for (size_t i = 0; i < buses.size(); ++i) {
+        if (terminals[i].count == 0) {
+            continue;
+        }
+        PrintBusLabels(writer_, *buses[i], terminals[i], bus_styles.underlayer,
+                       PaletteStyle(bus_styles.fill, color_index++), &viewport);
+    }
+
+    const auto stops = index.FindStops(viewport);
+    const auto circle_style = writer_.AddPathStyle(svg::PathStyle::Fill(svg::Color("white")));
+    for (const Stop* stop : stops) {
+        writer_.AddCircle(StopPoint(stop), settings_.stop_radius, circle_style);
+    }
+
+    if (zoom < settings_.stop_label_min_zoom) {
+        return;
+    }
+    const auto stop_styles = AddStopLabelStyles(writer_);
+    for (const Stop* stop : stops) {
+        const svg::Point point = StopPoint(stop);
+        writer_.AddText(point, stop->name, stop_styles.underlayer);
+        writer_.AddText(point, stop->name, stop_styles.fill[0]);
+    }
+}
+
+void MapRenderer::DrawLayers(raster::Canvas& canvas) const {
+    const auto route_styles = AddRouteStyles(canvas);
+    for (size_t i = 0; i < order_.buses.size(); ++i) {
+        PrintRoute(canvas, *order_.buses[i], PaletteStyle(route_styles, i));
+    }
+
+    const auto bus_styles = AddBusLabelStyles(canvas);
+    size_t color_index = 0;
+    for (size_t i = 0; i < order_.buses.size(); ++i) {
+        if (order_.terminals[i].count > 0) {
+            PrintBusLabels(canvas, *order_.buses[i], order_.terminals[i], bus_styles.underlayer,
+                           PaletteStyle(bus_styles.fill, color_index++), nullptr);
+        }
+    }
+
+    const auto circle_style = canvas.AddPathStyle(svg::PathStyle::Fill(svg::Color("white")));
+    for (const Stop* stop : order_.stops) {
+        canvas.AddCircle(StopPoint(stop), settings_.stop_radius, circle_style);
+    }
+    const auto stop_styles = AddStopLabelStyles(canvas);
+    for (const Stop* stop : order_.stops) {
+        const svg::Point point = StopPoint(stop);
+        canvas.AddText(point, stop->name, stop_styles.underlayer);
+        canvas.AddText(point, stop->name, stop_styles.fill[0]);
+    }
+}
+
+void MapRenderer::PrintTile(const Tile& tile) {
+    // На масштабе zoom большая сторона карты занимает 2^zoom тайлов
+    const double side = std::max(settings_.width, settings_.height);
+    const double scale = TILE_SIZE * static_cast<double>(size_t(1) << tile.zoom) / (side > 0 ? side : 1);
+    raster::Canvas canvas(TILE_SIZE, TILE_SIZE, scale,
+                          {static_cast<double>(tile.x) * TILE_SIZE, static_cast<double>(tile.y) * TILE_SIZE});
+    DrawLayers(canvas);
+    canvas.WritePng(out_);
+}
+
+MapIndex::MapIndex(const RenderOrder& order)
+        : buses_(order.buses), terminals_(order.terminals), stops_(order.stops) {
+    if (stops_.empty()) {
+        cells_.resize(1);
+        return;
+    }
+
+    bounds_ = {stops_[0]->coord.lat, stops_[0]->coord.lng, stops_[0]->coord.lat, stops_[0]->coord.lng};
+    for (const Stop* stop : stops_) {
+        bounds_.min_lat = std::min(bounds_.min_lat, stop->coord.lat);
+        bounds_.max_lat = std::max(bounds_.max_lat, stop->coord.lat);
+        bounds_.min_lng = std::min(bounds_.min_lng, stop->coord.lng);
+        bounds_.max_lng = std::max(bounds_.max_lng, stop->coord.lng);
+    }
+    // Около одной остановки на ячейку
+    rows_ = columns_ = std::max<size_t>(1, static_cast<size_t>(std::sqrt(stops_.size())));
+    cells_.resize(rows_ * columns_);
+
+    for (size_t i = 0; i < stops_.size(); ++i) {
+        cells_[CellRow(stops_[i]->coord.lat) * columns_ + CellColumn(stops_[i]->coord.lng)].stops.push_back(i);
+    }
+    for (size_t bus = 0; bus < buses_.size(); ++bus) {
+        const auto& stop_names = buses_[bus]->stop_names;
+        for (size_t i = 0; i + 1 < stop_names.size(); ++i) {
+            const size_t row_from = CellRow(stop_names[i]->coord.lat);
+            const size_t row_to = CellRow(stop_names[i + 1]->coord.lat);
+            const size_t column_from = CellColumn(stop_names[i]->coord.lng);
+            const size_t column_to = CellColumn(stop_names[i + 1]->coord.lng);
+            const auto [row_min, row_max] = std::minmax(row_from, row_to);
+            const auto [column_min, column_max] = std::minmax(column_from, column_to);
+            for (size_t row = row_min; row <= row_max; ++row) {
+                for (size_t column = column_min; column <= column_max; ++column) {
+                    cells_[row * columns_ + column].segments.push_back({bus, i});
+                }
+            }
+        }
+    }
+}
+
+size_t MapIndex::CellRow(double lat) const {
+    const double range = bounds_.max_lat - bounds_.min_lat;
+    if (IsZero(range)) {
+        return 0;
+    }
+    const double row = std::floor((lat - bounds_.min_lat) / range * rows_);
+    return static_cast<size_t>(std::clamp(row, 0.0, static_cast<double>(rows_ - 1)));
+}
+
+size_t MapIndex::CellColumn(double lng) const {
+    const double range = bounds_.max_lng - bounds_.min_lng;
+    if (IsZero(range)) {
+        return 0;
+    }
+    const double column = std::floor((lng - bounds_.min_lng) / range * columns_);
+    return static_cast<size_t>(std::clamp(column, 0.0, static_cast<double>(columns_ - 1)));
+}
+
+vector<const Stop*> MapIndex::FindStops(const Viewport& viewport) const {
+    vector<const Stop*> result;
+    if (stops_.empty() || viewport.max_lat < bounds_.min_lat || viewport.min_lat > bounds_.max_lat
+        || viewport.max_lng < bounds_.min_lng || viewport.min_lng > bounds_.max_lng) {
+        return result;
+    }
+    vector<size_t> found;
+    for (size_t row = CellRow(viewport.min_lat); row <= CellRow(viewport.max_lat); ++row) {
+        for (size_t column = CellColumn(viewport.min_lng); column <= CellColumn(viewport.max_lng); ++column) {
+            for (size_t stop : cells_[row * columns_ + column].stops) {
+                if (viewport.Contains(stops_[stop]->coord)) {
+                    found.push_back(stop);
+                }
+            }
+        }
+    }
+    sort(found.begin(), found.end());
+    result.reserve(found.size());
+    for (size_t stop : found) {
+        result.push_back(stops_[stop]);
+    }
+    return result;
+}
+
+vector<MapIndex::Segment> MapIndex::FindSegments(const Viewport& viewport) const {
+    vector<Segment> result;
+    if (stops_.empty() || viewport.max_lat < bounds_.min_lat || viewport.min_lat > bounds_.max_lat
+        || viewport.max_lng < bounds_.min_lng || viewport.min_lng > bounds_.max_lng) {
+        return result;
+    }
+    for (size_t row = CellRow(viewport.min_lat); row <= CellRow(viewport.max_lat); ++row) {
+        for (size_t column = CellColumn(viewport.min_lng); column <= CellColumn(viewport.max_lng); ++column) {
+            for (const Segment& segment : cells_[row * columns_ + column].segments) {
+                const auto& stop_names = buses_[segment.bus]->stop_names;
+                const auto from = stop_names[segment.index]->coord;
+                const auto to = stop_names[segment.index + 1]->coord;
+                if (std::max(from.lat, to.lat) >= viewport.min_lat && std::min(from.lat, to.lat) <= viewport.max_lat
+                    && std::max(from.lng, to.lng) >= viewport.min_lng && std::min(from.lng, to.lng) <= viewport.max_lng) {
+                    result.push_back(segment);
+                }
+            }
+        }
+    }
+    auto less = [](const Segment& lhs, const Segment& rhs) {
+        return std::tie(lhs.bus, lhs.index) < std::tie(rhs.bus, rhs.index);
     };
-    set<Stop*, decltype(cmp)> stops(cmp);
-    for (auto& [name, bus] : buses_map_) {
-        for (auto& point : bus.stop_names) {
-            stops.insert(point);
+    auto equal = [](const Segment& lhs, const Segment& rhs) {
+        return lhs.bus == rhs.bus && lhs.index == rhs.index;
+    };
+    sort(result.begin(), result.end(), less);
+    result.erase(unique(result.begin(), result.end(), equal), result.end());
+    return result;
+}
+
+namespace {
+
+void HashCombine(size_t& seed, size_t value) {
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+struct ColorHasher {
+    size_t operator()(std::monostate) const {
+        return 0;
+    }
+
+    size_t operator()(const string& str) const {
+        return hash<string>{}(str);
+    }
+
+    size_t operator()(svg::Rgb rgb) const {
+        return (size_t(rgb.red) << 16) | (size_t(rgb.green) << 8) | rgb.blue;
+    }
+
+    size_t operator()(svg::Rgba rgba) const {
+        size_t seed = (size_t(rgba.red) << 16) | (size_t(rgba.green) << 8) | rgba.blue;
+        HashCombine(seed, hash<double>{}(rgba.opacity));
+        return seed;
+    }
+};
+
+void HashColor(size_t& seed, const svg::Color& color) {
+    HashCombine(seed, color.index());
+    HashCombine(seed, visit(ColorHasher{}, color));
+}
+
+bool SameColor(const svg::Color& lhs, const svg::Color& rhs) {
+    if (lhs.index() != rhs.index()) {
+        return false;
+    }
+    if (const auto* rgb = get_if<svg::Rgb>(&lhs)) {
+        const auto& other = get<svg::Rgb>(rhs);
+        return rgb->red == other.red && rgb->green == other.green && rgb->blue == other.blue;
+    }
+    if (const auto* rgba = get_if<svg::Rgba>(&lhs)) {
+        const auto& other = get<svg::Rgba>(rhs);
+        return rgba->red == other.red && rgba->green == other.green && rgba->blue == other.blue
+               && rgba->opacity == other.opacity;
+    }
+    if (const auto* name = get_if<string>(&lhs)) {
+        return *name == get<string>(rhs);
+    }
+    return true;
+}
+
+}  // namespace
+
+size_t HashRenderSettings(const RenderSettings& settings) {
+    hash<double> double_hasher;
+    size_t seed = 0;
+    for (double value : {settings.width, settings.height, settings.padding, settings.line_width,
+                         settings.stop_radius, settings.bus_label_offset.first, settings.bus_label_offset.second,
+                         settings.stop_label_offset.first, settings.stop_label_offset.second,
+                         settings.underlayer_width}) {
+        HashCombine(seed, double_hasher(value));
+    }
+    HashCombine(seed, settings.bus_label_font_size);
+    HashCombine(seed, settings.stop_label_font_size);
+    HashCombine(seed, settings.stop_label_min_zoom);
+    HashCombine(seed, hash<double>{}(settings.route_simplify_tolerance));
+    HashCombine(seed, settings.compact_svg);
+    HashCombine(seed, settings.compact_svg_precision);
+    HashColor(seed, settings.underlayer_color);
+    for (const auto& color : settings.color_palette) {
+        HashColor(seed, color);
+    }
+    return seed;
+}
+
+bool SameRenderSettings(const RenderSettings& lhs, const RenderSettings& rhs) {
+    return lhs.width == rhs.width && lhs.height == rhs.height && lhs.padding == rhs.padding
+           && lhs.line_width == rhs.line_width && lhs.stop_radius == rhs.stop_radius
+           && lhs.bus_label_font_size == rhs.bus_label_font_size && lhs.bus_label_offset == rhs.bus_label_offset
+           && lhs.stop_label_font_size == rhs.stop_label_font_size && lhs.stop_label_offset == rhs.stop_label_offset
+           && SameColor(lhs.underlayer_color, rhs.underlayer_color) && lhs.underlayer_width == rhs.underlayer_width
+           && equal(lhs.color_palette.begin(), lhs.color_palette.end(),
+                    rhs.color_palette.begin(), rhs.color_palette.end(), SameColor)
+           && lhs.stop_label_min_zoom == rhs.stop_label_min_zoom
+           && lhs.route_simplify_tolerance == rhs.route_simplify_tolerance
+           && lhs.compact_svg == rhs.compact_svg && lhs.compact_svg_precision == rhs.compact_svg_precision;
+}
+
+const std::string* MapCache::Find(uint64_t version, size_t settings_hash, const RenderSettings& settings) const {
+    auto it = maps_.find({version, settings_hash});
+    if (it == maps_.end() || !SameRenderSettings(it->second.settings, settings)) {
+        return nullptr;
+    }
+    return &it->second.svg;
+}
+
+const std::string& MapCache::Store(uint64_t version, size_t settings_hash, const RenderSettings& settings,
+                                   std::string svg) {
+    maps_.erase(maps_.begin(), maps_.lower_bound({version, 0}));
+    Entry& entry = maps_[{version, settings_hash}];
+    entry = {settings, move(svg)};
+    return entry.svg;
+}
+
+size_t HashNetwork(const RenderOrder& order, size_t seed) {
+    hash<string> string_hasher;
+    hash<double> double_hasher;
+    for (const Bus* bus : order.buses) {
+        HashCombine(seed, string_hasher(bus->name));
+        HashCombine(seed, bus->round_route);
+        for (const Stop* stop : bus->stop_names) {
+            HashCombine(seed, string_hasher(stop->name));
+            HashCombine(seed, double_hasher(stop->coord.lat));
+            HashCombine(seed, double_hasher(stop->coord.lng));
         }
     }
+    return seed;
+}
+
+TileCache::TileCache(string directory)
+        : directory_(move(directory)) {
+}
 
-    for (auto& stop : stops) {
-        svg::Circle circle;
-        circle.SetCenter(svg::Point(sphere_(stop->coord))).SetRadius(settings_.stop_radius).SetFillColor("white");
-        doc_.Add(circle);
+optional<string> TileCache::Find(uint64_t version, size_t key, const Tile& tile) const {
+    string path = GetPath(version, key, tile);
+    error_code error;
+    if (!filesystem::is_regular_file(path, error)) {
+        return nullopt;
     }
+    return path;
+}
 
-    for (auto& stop : stops) {
-        svg::Text text1;
-        svg::Text text2;
-        text1.SetPosition(sphere_(stop->coord)).SetOffset(svg::Point(settings_.stop_label_offset.first, settings_.stop_label_offset.second))
-                .SetFontSize(settings_.stop_label_font_size).SetFontFamily("Verdana").SetData(stop->name)
-                .SetFillColor(settings_.underlayer_color).SetStrokeColor(settings_.underlayer_color)
-                .SetStrokeWidth(settings_.underlayer_width).SetStrokeLineCap(svg::StrokeLineCap::ROUND)
-                .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-        text2.SetPosition(sphere_(stop->coord)).SetOffset(svg::Point(settings_.stop_label_offset.first, settings_.stop_label_offset.second))
-                .SetFontSize(settings_.stop_label_font_size).SetFontFamily("Verdana").SetData(stop->name)
-                .SetFillColor("black");
-        doc_.Add(text1);
-        doc_.Add(text2);
+string TileCache::Store(uint64_t version, size_t key, const Tile& tile, string_view png) const {
+    const filesystem::path path = GetPath(version, key, tile);
+    filesystem::create_directories(path.parent_path());
+    filesystem::path temp = path;
+    temp += ".tmp" + to_string(random_device{}());
+    {
+        ofstream out(temp, ios::binary);
+        out.write(png.data(), png.size());
+        if (!out) {
+            throw runtime_error("Cannot write tile " + temp.string());
+        }
     }
+    filesystem::rename(temp, path);
+    return path.string();
 }
 
-void MapRenderer::PrintMap() {
-    doc_.Render(out_);
+string TileCache::GetPath(uint64_t version, size_t key, const Tile& tile) const {
+    ostringstream path;
+    path << directory_ << '/' << version << '-' << hex << key << dec
+         << '/' << tile.zoom << '/' << tile.x << '/' << tile.y << ".png";
+    return path.str();
+}
+
+vector<svg::Point> SimplifyPolyline(const vector<svg::Point>& points, double tolerance) {
+    if (points.size() < 3) {
+        return points;
+    }
+    // Квадрат расстояния от точки p до отрезка a-b
+    auto distance2 = [](svg::Point p, svg::Point a, svg::Point b) {
+        const double dx = b.x - a.x;
+        const double dy = b.y - a.y;
+        const double length2 = dx * dx + dy * dy;
+        double t = IsZero(length2) ? 0 : ((p.x - a.x) * dx + (p.y - a.y) * dy) / length2;
+        t = std::clamp(t, 0.0, 1.0);
+        const double ex = a.x + t * dx - p.x;
+        const double ey = a.y + t * dy - p.y;
+        return ex * ex + ey * ey;
+    };
+
+    const double tolerance2 = tolerance * tolerance;
+    vector<bool> keep(points.size(), false);
+    keep.front() = keep.back() = true;
+    vector<pair<size_t, size_t>> ranges = {{0, points.size() - 1}};
+    while (!ranges.empty()) {
+        const auto [first, last] = ranges.back();
+        ranges.pop_back();
+        double max_distance2 = 0;
+        size_t farthest = first;
+        for (size_t i = first + 1; i < last; ++i) {
+            const double d2 = distance2(points[i], points[first], points[last]);
+            if (d2 > max_distance2) {
+                max_distance2 = d2;
+                farthest = i;
+            }
+        }
+        if (max_distance2 > tolerance2) {
+            keep[farthest] = true;
+            ranges.push_back({first, farthest});
+            ranges.push_back({farthest, last});
+        }
+    }
+
+    vector<svg::Point> result;
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (keep[i]) {
+            result.push_back(points[i]);
+        }
+    }
+    return result;
 }
 
 bool IsZero(double value) {
     return std::abs(value) < EPSILON;
-}
\ No newline at end of file
+}
+
+MapRenderer::BusFragment MapRenderer::MakeBusFragment(const Bus& bus, const BusTerminals& terminals,
+                                                      size_t route_color, size_t label_color) const {
+    BusFragment fragment{route_color, label_color, bus.round_route, {}, {}, MakeWriter(), MakeWriter()};
+    fragment.stops.assign(bus.stop_names.begin(), bus.stop_names.end());
+    fragment.points.reserve(bus.stop_names.size());
+    for (const Stop* stop : bus.stop_names) {
+        fragment.points.push_back(StopPoint(stop));
+    }
+
+    PrintRoute(fragment.route, bus, PaletteStyle(AddRouteStyles(fragment.route), route_color));
+    if (terminals.count > 0) {
+        const auto styles = AddBusLabelStyles(fragment.labels);
+        PrintBusLabels(fragment.labels, bus, terminals, styles.underlayer, PaletteStyle(styles.fill, label_color),
+                       nullptr);
+    }
+    return fragment;
+}
+
+MapRenderer::StopFragment MapRenderer::MakeStopFragment(const Stop& stop) const {
+    StopFragment fragment{StopPoint(&stop), MakeWriter(), MakeWriter()};
+    fragment.circle.AddCircle(fragment.point, settings_.stop_radius,
+                              fragment.circle.AddPathStyle(svg::PathStyle::Fill(svg::Color("white"))));
+    const auto styles = AddStopLabelStyles(fragment.label);
+    fragment.label.AddText(fragment.point, stop.name, styles.underlayer);
+    fragment.label.AddText(fragment.point, stop.name, styles.fill[0]);
+    return fragment;
+}
+
+size_t MapRenderer::UpdateFragments() {
+    // Проекция зависит от всех остановок, поэтому её изменение отражается в положении точек
+    // и приводит к перерисовке всех затронутых фрагментов
+    InitSphere();
+
+    struct BusJob {
+        size_t bus;
+        size_t label_color;
+    };
+
+    // Цвет автобуса зависит от его позиции среди автобусов в порядке названий,
+    // цвет названия - от позиции среди автобусов с остановками
+    map<string, BusFragment> bus_fragments;
+    vector<BusJob> bus_jobs;
+    size_t label_color = 0;
+    size_t work = 0;
+    for (size_t route_color = 0; route_color < order_.buses.size(); ++route_color) {
+        const Bus& bus = *order_.buses[route_color];
+        auto node = bus_fragments_.extract(bus.name);
+        bool actual = !node.empty();
+        if (actual) {
+            const BusFragment& fragment = node.mapped();
+            actual = fragment.route_color == route_color && fragment.label_color == label_color
+                     && fragment.round_route == bus.round_route
+                     && equal(fragment.stops.begin(), fragment.stops.end(),
+                              bus.stop_names.begin(), bus.stop_names.end());
+            for (size_t i = 0; actual && i < fragment.points.size(); ++i) {
+                const svg::Point point = StopPoint(fragment.stops[i]);
+                actual = point.x == fragment.points[i].x && point.y == fragment.points[i].y;
+            }
+        }
+        if (actual) {
+            bus_fragments.insert(move(node));
+        } else {
+            bus_jobs.push_back({route_color, label_color});
+            work += bus.stop_names.size();
+        }
+        if (order_.terminals[route_color].count > 0) {
+            ++label_color;
+        }
+    }
+
+    map<string, StopFragment> stop_fragments;
+    vector<const Stop*> stop_jobs;
+    for (const Stop* stop : order_.stops) {
+        auto node = stop_fragments_.extract(stop->name);
+        const svg::Point point = StopPoint(stop);
+        if (!node.empty() && node.mapped().point.x == point.x && node.mapped().point.y == point.y) {
+            stop_fragments.insert(move(node));
+        } else {
+            stop_jobs.push_back(stop);
+        }
+    }
+    work += stop_jobs.size();
+
+    // Устаревшие фрагменты выводятся заново, при большом объёме работы - в нескольких потоках
+    vector<BusFragment> rendered_buses(bus_jobs.size());
+    vector<StopFragment> rendered_stops(stop_jobs.size());
+    const size_t chunk_count = ChunkCount(work);
+    ParallelFor(bus_jobs.size(), chunk_count, [&](size_t i) {
+        const size_t bus = bus_jobs[i].bus;
+        rendered_buses[i] = MakeBusFragment(*order_.buses[bus], order_.terminals[bus], bus, bus_jobs[i].label_color);
+    });
+    ParallelFor(stop_jobs.size(), chunk_count, [&](size_t i) {
+        rendered_stops[i] = MakeStopFragment(*stop_jobs[i]);
+    });
+    for (size_t i = 0; i < bus_jobs.size(); ++i) {
+        bus_fragments.emplace(order_.buses[bus_jobs[i].bus]->name, move(rendered_buses[i]));
+    }
+    for (size_t i = 0; i < stop_jobs.size(); ++i) {
+        stop_fragments.emplace(stop_jobs[i]->name, move(rendered_stops[i]));
+    }
+    bus_fragments_ = move(bus_fragments);
+    stop_fragments_ = move(stop_fragments);
+    return bus_jobs.size() + stop_jobs.size();
+}
+
+void MapRenderer::PrintLayers(const vector<Layer>& layers, size_t chunk_count) {
+    const auto policy = chunk_count > 1 ? launch::async : launch::deferred;
+    vector<future<svg::Writer>> parts;
+    for (const Layer& layer : layers) {
+        for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+            const size_t first = layer.size * chunk / chunk_count;
+            const size_t last = layer.size * (chunk + 1) / chunk_count;
+            parts.push_back(async(policy, [this, &layer, first, last] {
+                svg::Writer writer = MakeWriter();
+                layer.print_range(writer, first, last);
+                return writer;
+            }));
+        }
+    }
+    for (auto& part : parts) {
+        writer_.Append(part.get());
+    }
+}
+
+void MapRenderer::PrintFragments() {
+    // Стили всех слоёв регистрируются заранее в порядке слоёв, чтобы классы в выводе не зависели от фрагментов
+    writer_ = MakeWriter();
+    AddRouteStyles(writer_);
+    AddBusLabelStyles(writer_);
+    writer_.AddPathStyle(svg::PathStyle::Fill(svg::Color("white")));
+    AddStopLabelStyles(writer_);
+
+    vector<const BusFragment*> buses;
+    buses.reserve(bus_fragments_.size());
+    for (const auto& [name, fragment] : bus_fragments_) {
+        buses.push_back(&fragment);
+    }
+    vector<const StopFragment*> stops;
+    stops.reserve(stop_fragments_.size());
+    for (const auto& [name, fragment] : stop_fragments_) {
+        stops.push_back(&fragment);
+    }
+
+    // Каждая часть слоя дописывает в свой Writer фрагменты подряд идущих автобусов или остановок
+    PrintLayers({
+        {buses.size(), [&buses](svg::Writer& writer, size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                writer.Append(buses[i]->route);
+            }
+        }},
+        {buses.size(), [&buses](svg::Writer& writer, size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                writer.Append(buses[i]->labels);
+            }
+        }},
+        {stops.size(), [&stops](svg::Writer& writer, size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                writer.Append(stops[i]->circle);
+            }
+        }},
+        {stops.size(), [&stops](svg::Writer& writer, size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                writer.Append(stops[i]->label);
+            }
+        }},
+    }, ChunkCount(buses.size() + stops.size()));
+}
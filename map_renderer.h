@@ -1,9 +1,14 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include "domain.h"
+#include <functional>
 #include "geo.h"
+#include <optional>
+#include "raster.h"
 #include <string>
+#include <string_view>
 #include "svg.h"
 #include <utility>
 #include <variant>
@@ -19,6 +24,10 @@
 inline const double EPSILON = 1e-6;
 bool IsZero(double value);
 
+// Упрощает ломаную алгоритмом Дугласа - Пекера: удаляет вершины, отстоящие от
+// упрощённой линии не дальше чем на tolerance. Первая и последняя вершины сохраняются
+std::vector<svg::Point> SimplifyPolyline(const std::vector<svg::Point>& points, double tolerance);
+
 class SphereProjector {
 public:
     // points_begin и points_end задают начало и конец интервала элементов geo::Coordinates
@@ -37,26 +46,47 @@ public:
         const auto [left_it, right_it] = std::minmax_element(
                 points_begin, points_end,
                 [](auto lhs, auto rhs) { return lhs.lng < rhs.lng; });
-        min_lon_ = left_it->lng;
-        const double max_lon = right_it->lng;
 
         // Находим точки с минимальной и максимальной широтой
         const auto [bottom_it, top_it] = std::minmax_element(
                 points_begin, points_end,
                 [](auto lhs, auto rhs) { return lhs.lat < rhs.lat; });
-        const double min_lat = bottom_it->lat;
-        max_lat_ = top_it->lat;
+
+        SetBounds(bottom_it->lat, top_it->lat, left_it->lng, right_it->lng, max_width, max_height);
+    }
+
+    // Широты и долготы точек заданы отдельными массивами одинаковой длины.
+    // Границы находятся одним проходом по каждому массиву без ветвлений
+    SphereProjector(const std::vector<double>& lats, const std::vector<double>& lngs,
+                    double max_width, double max_height, double padding);
+
+    // Проецирует size точек за один проход; результат записывается в out[0..size)
+    void Project(const double* lats, const double* lngs, size_t size, svg::Point* out) const;
+
+    // Проецирует широту и долготу в координаты внутри SVG-изображения
+    svg::Point operator()(transport::geo::Coordinates coords) const {
+        return {
+                (coords.lng - min_lon_) * zoom_coeff_ + padding_,
+                (max_lat_ - coords.lat) * zoom_coeff_ + padding_
+        };
+    }
+
+private:
+    void SetBounds(double min_lat, double max_lat, double min_lon, double max_lon,
+                   double max_width, double max_height) {
+        min_lon_ = min_lon;
+        max_lat_ = max_lat;
 
         // Вычисляем коэффициент масштабирования вдоль координаты x
         std::optional<double> width_zoom;
         if (!IsZero(max_lon - min_lon_)) {
-            width_zoom = (max_width - 2 * padding) / (max_lon - min_lon_);
+            width_zoom = (max_width - 2 * padding_) / (max_lon - min_lon_);
         }
 
         // Вычисляем коэффициент масштабирования вдоль координаты y
         std::optional<double> height_zoom;
         if (!IsZero(max_lat_ - min_lat)) {
-            height_zoom = (max_height - 2 * padding) / (max_lat_ - min_lat);
+            height_zoom = (max_height - 2 * padding_) / (max_lat_ - min_lat);
         }
 
         if (width_zoom && height_zoom) {
@@ -72,16 +102,7 @@ public:
         }
     }
 
-    // Проецирует широту и долготу в координаты внутри SVG-изображения
-    svg::Point operator()(transport::geo::Coordinates coords) const {
-        return {
-                (coords.lng - min_lon_) * zoom_coeff_ + padding_,
-                (max_lat_ - coords.lat) * zoom_coeff_ + padding_
-        };
-    }
-
-private:
-    double padding_;
+    double padding_ = 0;
     double min_lon_ = 0;
     double max_lat_ = 0;
     double zoom_coeff_ = 0;
@@ -100,14 +121,27 @@ struct RenderSettings {
     svg::Color underlayer_color;
     double underlayer_width;
     std::vector<svg::Color> color_palette;
+    // Минимальный масштаб, начиная с которого на фрагменте карты выводятся названия остановок
+    int stop_label_min_zoom = 0;
+    // Допуск упрощения линий маршрутов в пикселях; 0 - линии выводятся без упрощения
+    double route_simplify_tolerance = 0;
+    // Компактный вывод SVG: общие стили в блоке <style> и округлённые координаты
+    bool compact_svg = false;
+    int compact_svg_precision = 3;
+    // Каталог дискового кэша растровых тайлов; на вид карты не влияет и в хэш настроек не входит
+    std::string tile_cache_dir = "tiles";
 
     size_t index = 0;
 
-    svg::Color nextColor() {
+    size_t nextColorIndex() {
         if (index == color_palette.size()) {
             index = 0;
         }
-        return color_palette.at(index++);
+        return index++;
+    }
+
+    svg::Color nextColor() {
+        return color_palette.at(nextColorIndex());
     }
 
     void reset() {
@@ -115,22 +149,221 @@ struct RenderSettings {
     }
 };
 
+// Хэш настроек отрисовки; текущая позиция в палитре (index) не учитывается
+size_t HashRenderSettings(const RenderSettings& settings);
+
+// Совпадают ли настройки отрисовки; как и в HashRenderSettings, не учитываются
+// позиция в палитре и каталог кэша тайлов
+bool SameRenderSettings(const RenderSettings& lhs, const RenderSettings& rhs);
+
+// Кэш отрисованных карт. Ключ - версия справочника и хэш настроек отрисовки,
+// поэтому повторный запрос карты неизменной сети не приводит к новой отрисовке.
+// Вместе с картой хранятся её настройки: при совпадении хэшей разных настроек карта не найдётся
+class MapCache {
+public:
+    const std::string* Find(uint64_t version, size_t settings_hash, const RenderSettings& settings) const;
+
+    // Сохраняет карту; карты, отрисованные для прежних версий справочника, удаляются
+    const std::string& Store(uint64_t version, size_t settings_hash, const RenderSettings& settings,
+                             std::string svg);
+
+private:
+    struct Entry {
+        RenderSettings settings;
+        std::string svg;
+    };
+
+    std::map<std::pair<uint64_t, size_t>, Entry> maps_;
+};
+
+// Прямоугольная область карты в географических координатах
+struct Viewport {
+    double min_lat = 0;
+    double min_lng = 0;
+    double max_lat = 0;
+    double max_lng = 0;
+
+    bool Contains(transport::geo::Coordinates coord) const {
+        return coord.lat >= min_lat && coord.lat <= max_lat && coord.lng >= min_lng && coord.lng <= max_lng;
+    }
+};
+
+// Сеточный пространственный индекс остановок и отрезков маршрутов.
+// Строится один раз для неизменной сети и позволяет выбрать только то, что попадает в область карты
+class MapIndex {
+public:
+    struct Segment {
+        size_t bus;    // номер автобуса в порядке названий
+        size_t index;  // отрезок между остановками index и index + 1
+    };
+
+    explicit MapIndex(const RenderOrder& order);
+
+    // Автобусы в порядке названий
+    const std::vector<const Bus*>& GetBuses() const {
+        return buses_;
+    }
+
+    // Конечные остановки автобусов в том же порядке
+    const std::vector<BusTerminals>& GetTerminals() const {
+        return terminals_;
+    }
+
+    // Остановки внутри области в порядке названий
+    std::vector<const Stop*> FindStops(const Viewport& viewport) const;
+
+    // Отрезки, чьи ограничивающие прямоугольники пересекают область, упорядоченные по автобусу и номеру
+    std::vector<Segment> FindSegments(const Viewport& viewport) const;
+
+private:
+    struct Cell {
+        std::vector<size_t> stops;
+        std::vector<Segment> segments;
+    };
+
+    size_t CellRow(double lat) const;
+    size_t CellColumn(double lng) const;
+
+    std::vector<const Bus*> buses_;
+    std::vector<BusTerminals> terminals_;
+    std::vector<const Stop*> stops_;
+    Viewport bounds_;
+    size_t rows_ = 1;
+    size_t columns_ = 1;
+    std::vector<Cell> cells_;
+};
+
+// Тайл - квадрат растровой карты размером TILE_SIZE x TILE_SIZE пикселей. На масштабе zoom
+// большая сторона карты занимает 2^zoom тайлов; x и y - номера столбца и строки тайла
+inline const int TILE_SIZE = 256;
+inline const int MAX_TILE_ZOOM = 20;
+
+struct Tile {
+    int zoom = 0;
+    int x = 0;
+    int y = 0;
+
+    bool IsValid() const {
+        return zoom >= 0 && zoom <= MAX_TILE_ZOOM && x >= 0 && y >= 0 && x < (1 << zoom) && y < (1 << zoom);
+    }
+};
+
+// Хэш состава сети, отображаемого на карте: маршруты, их остановки и координаты остановок.
+// seed позволяет объединить его с другим хэшем, например хэшем настроек отрисовки
+size_t HashNetwork(const RenderOrder& order, size_t seed = 0);
+
+// Дисковый кэш тайлов в формате PNG. Тайл хранится в файле
+// <каталог>/<версия справочника>-<ключ>/<zoom>/<x>/<y>.png, где ключ объединяет
+// хэши настроек отрисовки и состава сети, поэтому кэш можно использовать и после перезапуска
+class TileCache {
+public:
+    explicit TileCache(std::string directory);
+
+    // Путь к файлу тайла, если тайл уже отрисован
+    std::optional<std::string> Find(uint64_t version, size_t key, const Tile& tile) const;
+
+    // Записывает тайл через временный файл, чтобы читатели не увидели его недописанным.
+    // Возвращает путь к файлу
+    std::string Store(uint64_t version, size_t key, const Tile& tile, std::string_view png) const;
+
+private:
+    std::string GetPath(uint64_t version, size_t key, const Tile& tile) const;
+
+    std::string directory_;
+};
+
 class MapRenderer {
 public:
-    MapRenderer(std::map<std::string, Bus>& buses_map, RenderSettings settings, std::ostream& out)
-            : buses_map_(buses_map), settings_(settings), out_(out) {
+    // Порядок вывода order должен оставаться неизменным, пока используется отрисовщик
+    MapRenderer(const RenderOrder& order, RenderSettings settings, std::ostream& out)
+            : order_(order), settings_(settings), out_(out), writer_(MakeWriter()) {
     }
 
     void InitSphere();
-    void PrintRoutes();
-    void PrintBusText();
-    void PrintStops();
     void PrintMap();
 
+    // Отрисовывает только часть карты внутри области: проецирует область на всё изображение,
+    // обрезает линии маршрутов по её границе и скрывает названия остановок при малом масштабе
+    void PrintViewport(const MapIndex& index, const Viewport& viewport, int zoom);
+
+    // Растеризует все слои карты (после InitSphere) в одно изображение
+    void DrawLayers(raster::Canvas& canvas) const;
+
+    // Выводит тайл карты в формате PNG (после InitSphere)
+    void PrintTile(const Tile& tile);
+
+    // Приводит фрагменты карты (отдельно для каждого автобуса и каждой остановки) в соответствие
+    // с текущими маршрутами. Заново выводятся только фрагменты, у которых изменились остановки,
+    // их положение на карте или цвет. Возвращает число перерисованных фрагментов
+    size_t UpdateFragments();
+
+    // Собирает карту из фрагментов, построенных UpdateFragments: линии маршрутов, названия автобусов,
+    // круги и названия остановок; слои собираются частями параллельно (PrintLayers).
+    // Ранее выведенное содержимое карты отбрасывается
+    void PrintFragments();
+
 private:
-    std::map<std::string, Bus> buses_map_;
+    struct LabelStyles {
+        svg::Writer::StyleId underlayer;
+        std::vector<svg::Writer::StyleId> fill;
+    };
+
+    struct BusFragment {
+        size_t route_color = 0;
+        size_t label_color = 0;
+        bool round_route = false;
+        std::vector<const Stop*> stops;
+        std::vector<svg::Point> points;
+        svg::Writer route;
+        svg::Writer labels;
+    };
+
+    struct StopFragment {
+        svg::Point point;
+        svg::Writer circle;
+        svg::Writer label;
+    };
+
+    // Слой карты из size элементов; print_range(writer, first, last) выводит элементы [first, last)
+    struct Layer {
+        size_t size = 0;
+        std::function<void(svg::Writer& writer, size_t first, size_t last)> print_range;
+    };
+
+    // Выводит слои по порядку, разбивая каждый на chunk_count частей. Части строятся
+    // параллельно, каждая в своём Writer, и дописываются строго в порядке слоёв и частей
+    void PrintLayers(const std::vector<Layer>& layers, size_t chunk_count);
+
+    BusFragment MakeBusFragment(const Bus& bus, const BusTerminals& terminals,
+                                size_t route_color, size_t label_color) const;
+    StopFragment MakeStopFragment(const Stop& stop) const;
+
+    svg::Writer MakeWriter() const;
+    // Положение остановки на карте: заранее спроецированное в InitSphere или вычисленное на месте
+    svg::Point StopPoint(const Stop* stop) const;
+
+    // Фигуры выводятся в svg::Writer или в растровый холст raster::Canvas, у которых общий набор вызовов
+    template <typename Target>
+    std::vector<svg::Writer::StyleId> AddRouteStyles(Target& writer) const;
+    template <typename Target>
+    LabelStyles AddBusLabelStyles(Target& writer) const;
+    template <typename Target>
+    LabelStyles AddStopLabelStyles(Target& writer) const;
+    template <typename Target>
+    void PrintRoute(Target& writer, const Bus& bus, svg::Writer::StyleId style) const;
+    template <typename Target>
+    void PrintBusLabels(Target& writer, const Bus& bus, const BusTerminals& terminals,
+                        svg::Writer::StyleId underlayer, svg::Writer::StyleId style,
+                        const Viewport* viewport) const;
+
+    const RenderOrder& order_;
     RenderSettings settings_;
     std::ostream& out_;
-    svg::Document doc_;
+    svg::Writer writer_;
     SphereProjector sphere_;
+    // Проекции остановок по их номерам в справочнике для текущей проекции sphere_
+    std::vector<svg::Point> stop_points_;
+    // Фрагменты карты по названиям автобусов и остановок
+    std::map<std::string, BusFragment> bus_fragments_;
+    std::map<std::string, StopFragment> stop_fragments_;
 };
\ No newline at end of file
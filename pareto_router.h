@@ -0,0 +1,155 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+/*
+ * Поиск маршрутов, оптимальных по Парето по двум критериям: суммарному весу и числу поездок.
+ * В графе справочника ребро - это поездка одним автобусом или переход пешком (Edge::walk);
+ * поездками считаются только рёбра-автобусы, поэтому число поездок на единицу больше числа
+ * пересадок, а пешие переходы пересадок не добавляют.
+ *
+ * Метки (вес, число поездок) извлекаются из очереди в порядке возрастания веса, а при равном
+ * весе - числа поездок. Поэтому метка вершины недоминируема, только если у неё меньше поездок,
+ * чем у всех ранее извлечённых меток этой вершины: множество меток вершины ограничено
+ * числом различных количеств поездок, а проверка доминирования сводится к одному сравнению.
+ * Метки, доминируемые уже найденными маршрутами до цели или тяжелее самого быстрого
+ * маршрута больше чем на max_extra_weight, отбрасываются. Вещественные веса, отличающиеся
+ * лишь погрешностью округления, считаются равными: иначе маршрут с лишней пересадкой,
+ * быстрее на долю ошибки округления, попадал бы в ответ как отдельный вариант.
+ *
+ * Вес ребра - edge_weight(edge), по умолчанию хранящийся в графе.
+ */
+template <typename Weight, typename EdgeWeight = StoredEdgeWeight<Weight>>
+class ParetoRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    explicit ParetoRouter(const Graph& graph, EdgeWeight edge_weight = {});
+
+    struct RouteInfo {
+        Weight weight;
+        std::vector<EdgeId> edges;
+    };
+
+    // Маршруты в порядке возрастания веса (и убывания числа поездок); первый - самый быстрый.
+    // Пустой результат - цель недостижима
+    std::vector<RouteInfo> BuildRoutes(VertexId from, VertexId to,
+                                       std::optional<Weight> max_extra_weight = std::nullopt,
+                                       size_t max_rides = std::numeric_limits<size_t>::max()) const;
+
+private:
+    static constexpr size_t NO_LABEL = std::numeric_limits<size_t>::max();
+
+    struct QueueItem {
+        Weight weight;
+        size_t ride_count;
+        VertexId vertex;
+        size_t parent;
+        EdgeId edge;
+
+        bool operator>(const QueueItem& other) const {
+            return weight != other.weight ? weight > other.weight : ride_count > other.ride_count;
+        }
+    };
+
+    struct Label {
+        size_t parent;
+        EdgeId edge;
+    };
+
+    static bool Exceeds(Weight weight, Weight limit) {
+        if constexpr (std::is_floating_point_v<Weight>) {
+            return weight > limit + std::abs(limit) * WEIGHT_EPSILON;
+        } else {
+            return weight > limit;
+        }
+    }
+
+    static constexpr double WEIGHT_EPSILON = 1e-9;
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    EdgeWeight edge_weight_;
+};
+
+template <typename Weight, typename EdgeWeight>
+ParetoRouter<Weight, EdgeWeight>::ParetoRouter(const Graph& graph, EdgeWeight edge_weight)
+    : graph_(graph)
+    , edge_weight_(std::move(edge_weight)) {
+}
+
+template <typename Weight, typename EdgeWeight>
+std::vector<typename ParetoRouter<Weight, EdgeWeight>::RouteInfo> ParetoRouter<Weight, EdgeWeight>::BuildRoutes(
+        VertexId from, VertexId to, std::optional<Weight> max_extra_weight, size_t max_rides) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    // Наименьшее число поездок среди извлечённых меток вершины
+    std::vector<size_t> best_rides(vertex_count, std::numeric_limits<size_t>::max());
+    std::vector<Label> labels;
+    std::vector<std::pair<Weight, size_t>> targets;
+    std::optional<Weight> weight_limit;
+
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+    queue.push({ZERO_WEIGHT, 0, from, NO_LABEL, 0});
+    while (!queue.empty()) {
+        const QueueItem item = queue.top();
+        queue.pop();
+        if (item.ride_count >= best_rides[item.vertex] || item.ride_count >= best_rides[to]) {
+            continue;
+        }
+        if (weight_limit && Exceeds(item.weight, *weight_limit)) {
+            break;
+        }
+        best_rides[item.vertex] = item.ride_count;
+        const size_t label = labels.size();
+        labels.push_back({item.parent, item.edge});
+        if (item.vertex == to) {
+            if (!weight_limit && max_extra_weight) {
+                weight_limit = item.weight + *max_extra_weight;
+            }
+            // Маршрут с меньшим числом поездок и практически тем же весом вытесняет найденные
+            while (!targets.empty() && !Exceeds(item.weight, targets.back().first)) {
+                targets.pop_back();
+            }
+            targets.emplace_back(item.weight, label);
+            continue;
+        }
+
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(item.vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Weight edge_weight = edge_weight_(edge);
+            if (edge_weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            const size_t ride_count = item.ride_count + (edge.walk ? 0 : 1);
+            if (ride_count <= max_rides && ride_count < best_rides[edge.to] && ride_count < best_rides[to]) {
+                queue.push({item.weight + edge_weight, ride_count, edge.to, label, edge_id});
+            }
+        }
+    }
+
+    std::vector<RouteInfo> routes;
+    routes.reserve(targets.size());
+    for (const auto& [weight, target] : targets) {
+        std::vector<EdgeId> edges;
+        for (size_t label = target; labels[label].parent != NO_LABEL; label = labels[label].parent) {
+            edges.push_back(labels[label].edge);
+        }
+        std::reverse(edges.begin(), edges.end());
+        routes.push_back({weight, std::move(edges)});
+    }
+    return routes;
+}
+
+}  // namespace graph
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+/*
+ * Монотонная очередь с приоритетом для целочисленных беззнаковых ключей (radix heap).
+ *
+ * Подходит для поиска Дейкстры с неотрицательными целыми весами: ключи извлекаются
+ * в порядке возрастания, и каждый добавляемый ключ не меньше последнего извлечённого.
+ * Элемент лежит в корзине с номером старшего бита, в котором его ключ отличается от
+ * последнего извлечённого; корзина 0 - ключи, равные ему. Когда корзина 0 пуста, первая
+ * непустая корзина раскладывается заново относительно своего минимума, и каждый элемент
+ * при этом переходит в корзину с меньшим номером. Поэтому элемент перекладывается не больше
+ * числа бит ключа раз, а сравнений ключей нет вовсе.
+ *
+ * Интерфейс повторяет std::priority_queue с std::greater<> для пар (ключ, значение).
+ */
+template <typename Key, typename Value>
+class RadixHeap {
+    static_assert(std::is_integral_v<Key> && std::is_unsigned_v<Key>, "Radix heap keys should be unsigned integers");
+
+public:
+    using value_type = std::pair<Key, Value>;
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    void push(const value_type& item) {
+        if (item.first < last_) {
+            throw std::invalid_argument("Radix heap key is less than the last extracted key");
+        }
+        buckets_[BucketIndex(item.first)].push_back(item);
+        ++size_;
+    }
+
+    // Элемент с наименьшим ключом; ключ становится нижней границей для следующих push
+    const value_type& top() {
+        if (buckets_[0].empty()) {
+            Redistribute();
+        }
+        return buckets_[0].back();
+    }
+
+    void pop() {
+        top();
+        buckets_[0].pop_back();
+        --size_;
+    }
+
+private:
+    static constexpr size_t KEY_BITS = std::numeric_limits<Key>::digits;
+
+    size_t BucketIndex(Key key) const {
+        return key == last_ ? 0 : BitWidth(key ^ last_);
+    }
+
+    static size_t BitWidth(Key value) {
+#if defined(__GNUC__)
+        return std::numeric_limits<unsigned long long>::digits
+               - static_cast<size_t>(__builtin_clzll(static_cast<unsigned long long>(value)));
+#else
+        size_t width = 0;
+        for (; value != 0; value >>= 1) {
+            ++width;
+        }
+        return width;
+#endif
+    }
+
+    void Redistribute() {
+        size_t index = 1;
+        while (buckets_[index].empty()) {
+            ++index;
+        }
+        Key minimum = buckets_[index].front().first;
+        for (const value_type& item : buckets_[index]) {
+            if (item.first < minimum) {
+                minimum = item.first;
+            }
+        }
+        last_ = minimum;
+        // Корзина меняется местами с пустым буфером, чтобы память обоих векторов переиспользовалась
+        buffer_.clear();
+        buffer_.swap(buckets_[index]);
+        for (const value_type& item : buffer_) {
+            buckets_[BucketIndex(item.first)].push_back(item);
+        }
+    }
+
+    // Корзина i > 0 - ключи, у которых старший бит отличия от last_ равен i - 1
+    std::array<std::vector<value_type>, KEY_BITS + 1> buckets_;
+    std::vector<value_type> buffer_;
+    Key last_ = 0;
+    size_t size_ = 0;
+};
+
+}  // namespace graph
@@ -0,0 +1,610 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include "raster.h"
+#include <string>
+
+using namespace std;
+
+namespace raster {
+
+    namespace {
+
+    // Растровый шрифт 5x7: по строке на байт, старший из пяти бит - левая точка.
+    // Знаки с кодами 32..126, последним - заменитель для остальных символов
+    const uint8_t FONT[][7] = {
+            {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},  // space
+            {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04},  // !
+            {0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00},  // "
+            {0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A},  // #
+            {0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04},  // $
+            {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03},  // %
+            {0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D},  // &
+            {0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00},  // '
+            {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02},  // (
+            {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08},  // )
+            {0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00},  // *
+            {0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00},  // +
+            {0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08},  // ,
+            {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00},  // -
+            {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C},  // .
+            {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00},  // /
+            {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E},  // 0
+            {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E},  // 1
+            {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F},  // 2
+            {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E},  // 3
+            {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02},  // 4
+            {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E},  // 5
+            {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E},  // 6
+            {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08},  // 7
+            {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E},  // 8
+            {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C},  // 9
+            {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00},  // :
+            {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08},  // ;
+            {0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02},  // <
+            {0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00},  // =
+            {0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08},  // >
+            {0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04},  // ?
+            {0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E},  // @
+            {0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11},  // A
+            {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E},  // B
+            {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E},  // C
+            {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C},  // D
+            {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F},  // E
+            {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10},  // F
+            {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F},  // G
+            {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11},  // H
+            {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E},  // I
+            {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C},  // J
+            {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11},  // K
+            {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F},  // L
+            {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11},  // M
+            {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11},  // N
+            {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E},  // O
+            {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10},  // P
+            {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D},  // Q
+            {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11},  // R
+            {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E},  // S
+            {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04},  // T
+            {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E},  // U
+            {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04},  // V
+            {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A},  // W
+            {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11},  // X
+            {0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04},  // Y
+            {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F},  // Z
+            {0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E},  // [
+            {0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00},  // backslash
+            {0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E},  // ]
+            {0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00},  // ^
+            {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F},  // _
+            {0x08, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00},  // `
+            {0x00, 0x00, 0x0E, 0x01, 0x0F, 0x11, 0x0F},  // a
+            {0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1E},  // b
+            {0x00, 0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E},  // c
+            {0x01, 0x01, 0x0D, 0x13, 0x11, 0x11, 0x0F},  // d
+            {0x00, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E},  // e
+            {0x06, 0x09, 0x08, 0x1C, 0x08, 0x08, 0x08},  // f
+            {0x00, 0x0F, 0x11, 0x11, 0x0F, 0x01, 0x0E},  // g
+            {0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11},  // h
+            {0x04, 0x00, 0x0C, 0x04, 0x04, 0x04, 0x0E},  // i
+            {0x02, 0x00, 0x06, 0x02, 0x02, 0x12, 0x0C},  // j
+            {0x10, 0x10, 0x12, 0x14, 0x18, 0x14, 0x12},  // k
+            {0x0C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E},  // l
+            {0x00, 0x00, 0x1A, 0x15, 0x15, 0x11, 0x11},  // m
+            {0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11},  // n
+            {0x00, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E},  // o
+            {0x00, 0x00, 0x1E, 0x11, 0x1E, 0x10, 0x10},  // p
+            {0x00, 0x00, 0x0D, 0x13, 0x0F, 0x01, 0x01},  // q
+            {0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10},  // r
+            {0x00, 0x00, 0x0E, 0x10, 0x0E, 0x01, 0x1E},  // s
+            {0x08, 0x08, 0x1C, 0x08, 0x08, 0x09, 0x06},  // t
+            {0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0D},  // u
+            {0x00, 0x00, 0x11, 0x11, 0x11, 0x0A, 0x04},  // v
+            {0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0A},  // w
+            {0x00, 0x00, 0x11, 0x0A, 0x04, 0x0A, 0x11},  // x
+            {0x00, 0x00, 0x11, 0x11, 0x0F, 0x01, 0x0E},  // y
+            {0x00, 0x00, 0x1F, 0x02, 0x04, 0x08, 0x1F},  // z
+            {0x02, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02},  // {
+            {0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04},  // |
+            {0x08, 0x04, 0x04, 0x02, 0x04, 0x04, 0x08},  // }
+            {0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00},  // ~
+            {0x1F, 0x11, 0x11, 0x11, 0x11, 0x11, 0x1F},  // прочие символы
+    };
+    const size_t GLYPH_COLUMNS = 5;
+    const size_t GLYPH_ROWS = 7;
+    // Ширина знака вместе с промежутком и размер шрифта в точках знака
+    const size_t GLYPH_ADVANCE = 6;
+    const double FONT_UNITS = 10;
+
+    const uint8_t* Glyph(unsigned char ch) {
+        if (ch < 32 || ch > 126) {
+            return FONT[127 - 32];
+        }
+        return FONT[ch - 32];
+    }
+
+    // Начальные байты символов UTF-8; продолжения многобайтовых символов пропускаются
+    template <typename Callback>
+    void ForEachSymbol(string_view data, Callback callback) {
+        for (unsigned char ch : data) {
+            if ((ch & 0xC0) != 0x80) {
+                callback(ch);
+            }
+        }
+    }
+
+    double Clamp01(double value) {
+        return std::clamp(value, 0.0, 1.0);
+    }
+
+    const pair<string_view, Pixel> NAMED_COLORS[] = {
+            {"black", {0, 0, 0, 255}},
+            {"blue", {0, 0, 255, 255}},
+            {"brown", {165, 42, 42, 255}},
+            {"cyan", {0, 255, 255, 255}},
+            {"gray", {128, 128, 128, 255}},
+            {"green", {0, 128, 0, 255}},
+            {"grey", {128, 128, 128, 255}},
+            {"lime", {0, 255, 0, 255}},
+            {"magenta", {255, 0, 255, 255}},
+            {"maroon", {128, 0, 0, 255}},
+            {"navy", {0, 0, 128, 255}},
+            {"olive", {128, 128, 0, 255}},
+            {"orange", {255, 165, 0, 255}},
+            {"pink", {255, 192, 203, 255}},
+            {"purple", {128, 0, 128, 255}},
+            {"red", {255, 0, 0, 255}},
+            {"silver", {192, 192, 192, 255}},
+            {"teal", {0, 128, 128, 255}},
+            {"transparent", {0, 0, 0, 0}},
+            {"white", {255, 255, 255, 255}},
+            {"yellow", {255, 255, 0, 255}},
+    };
+
+    struct ColorToPixel {
+        Pixel operator()(monostate) const {
+            return {};
+        }
+
+        Pixel operator()(const string& name) const {
+            if (name == "none"sv) {
+                return {};
+            }
+            if (name.size() == 7 && name[0] == '#') {
+                uint32_t value = 0;
+                const auto [end, error] = from_chars(name.data() + 1, name.data() + name.size(), value, 16);
+                if (error == errc{} && end == name.data() + name.size()) {
+                    return {static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 8),
+                            static_cast<uint8_t>(value), 255};
+                }
+            }
+            for (const auto& [color_name, pixel] : NAMED_COLORS) {
+                if (color_name == name) {
+                    return pixel;
+                }
+            }
+            return {0, 0, 0, 255};
+        }
+
+        Pixel operator()(svg::Rgb color) const {
+            return {color.red, color.green, color.blue, 255};
+        }
+
+        Pixel operator()(svg::Rgba color) const {
+            return {color.red, color.green, color.blue,
+                    static_cast<uint8_t>(lround(Clamp01(color.opacity) * 255))};
+        }
+    };
+
+    }  // namespace
+
+    Pixel ToPixel(const svg::Color& color) {
+        return visit(ColorToPixel{}, color);
+    }
+
+    Canvas::Canvas(size_t width, size_t height, double scale, svg::Point origin)
+            : width_(width)
+            , height_(height)
+            , scale_(scale)
+            , origin_(origin)
+            , pixels_(width * height)
+            , coverage_(width * height, 0.0f) {
+    }
+
+    Canvas::StyleId Canvas::AddPathStyle(const svg::PathStyle& style) {
+        Style result;
+        // Как и в SVG, заливка по умолчанию чёрная, а контур отсутствует
+        result.fill = style.fill ? ToPixel(*style.fill) : Pixel{0, 0, 0, 255};
+        result.stroke = style.stroke ? ToPixel(*style.stroke) : Pixel{};
+        result.stroke_width = style.width.value_or(1.0) * scale_;
+        styles_.push_back(result);
+        return styles_.size() - 1;
+    }
+
+    Canvas::StyleId Canvas::AddTextStyle(const svg::TextStyle& style) {
+        const StyleId id = AddPathStyle(style.path);
+        Style& result = styles_[id];
+        result.offset = {style.offset.x * scale_, style.offset.y * scale_};
+        result.font_size = style.size * scale_;
+        result.bold = style.font_weight == "bold"sv;
+        return id;
+    }
+
+    void Canvas::AddCircle(svg::Point center, double radius, StyleId style_id) {
+        const Style& style = styles_.at(style_id);
+        const svg::Point c = ToCanvas(center);
+        const double r = radius * scale_;
+        const double extent = r + style.stroke_width / 2 + 1;
+        if (!Intersects({c.x - extent, c.y - extent}, {c.x + extent, c.y + extent})) {
+            return;
+        }
+        if (style.fill.alpha > 0) {
+            CoverDisc(c, r);
+            Blend(style.fill);
+        }
+        if (style.stroke.alpha > 0 && style.stroke_width > 0) {
+            CoverRing(c, r, style.stroke_width / 2);
+            Blend(style.stroke);
+        }
+    }
+
+    void Canvas::BeginPolyline() {
+        polyline_.clear();
+    }
+
+    void Canvas::AddPolylinePoint(svg::Point point) {
+        polyline_.push_back(ToCanvas(point));
+    }
+
+    void Canvas::EndPolyline(StyleId style_id) {
+        const Style& style = styles_.at(style_id);
+        if (polyline_.empty() || style.stroke.alpha == 0 || style.stroke_width <= 0) {
+            return;
+        }
+        const double half_width = style.stroke_width / 2;
+        svg::Point min = polyline_.front();
+        svg::Point max = polyline_.front();
+        for (const svg::Point& point : polyline_) {
+            min = {std::min(min.x, point.x), std::min(min.y, point.y)};
+            max = {std::max(max.x, point.x), std::max(max.y, point.y)};
+        }
+        const double extent = half_width + 1;
+        if (!Intersects({min.x - extent, min.y - extent}, {max.x + extent, max.y + extent})) {
+            return;
+        }
+        // Покрытие всех отрезков объединяется до смешивания, чтобы соединения
+        // полупрозрачной линии не закрашивались дважды
+        CoverCapsule(polyline_.front(), polyline_.front(), half_width);
+        for (size_t i = 1; i < polyline_.size(); ++i) {
+            CoverCapsule(polyline_[i - 1], polyline_[i], half_width);
+        }
+        Blend(style.stroke);
+    }
+
+    template <typename GlyphCell>
+    void Canvas::ForEachGlyphCell(svg::Point pos, string_view data, const Style& style, GlyphCell cell) const {
+        const double unit = style.font_size / FONT_UNITS;
+        const svg::Point start = ToCanvas(pos);
+        double x = start.x + style.offset.x;
+        const double baseline = start.y + style.offset.y;
+        ForEachSymbol(data, [&](unsigned char ch) {
+            const uint8_t* glyph = Glyph(ch);
+            for (size_t row = 0; row < GLYPH_ROWS; ++row) {
+                const double top = baseline - static_cast<double>(GLYPH_ROWS - row) * unit;
+                // Жирное начертание дублирует каждую точку соседней справа
+                const unsigned bits = style.bold ? (glyph[row] << 1 | glyph[row]) : glyph[row] << 1;
+                for (size_t column = 0; column <= GLYPH_COLUMNS; ++column) {
+                    if (bits & (1u << (GLYPH_COLUMNS - column))) {
+                        const double left = x + static_cast<double>(column) * unit;
+                        cell(svg::Point{left, top}, svg::Point{left + unit, top + unit});
+                    }
+                }
+            }
+            x += GLYPH_ADVANCE * unit;
+        });
+    }
+
+    void Canvas::AddText(svg::Point pos, string_view data, StyleId style_id) {
+        const Style& style = styles_.at(style_id);
+        const double unit = style.font_size / FONT_UNITS;
+        size_t symbols = 0;
+        ForEachSymbol(data, [&symbols](unsigned char) {
+            ++symbols;
+        });
+        const svg::Point start = ToCanvas(pos);
+        const double left = start.x + style.offset.x;
+        const double baseline = start.y + style.offset.y;
+        const double extent = style.stroke_width / 2 + 1;
+        if (symbols == 0 || !Intersects({left - extent, baseline - GLYPH_ROWS * unit - extent},
+                                        {left + symbols * GLYPH_ADVANCE * unit + extent, baseline + extent})) {
+            return;
+        }
+        if (style.stroke.alpha > 0 && style.stroke_width > 0) {
+            ForEachGlyphCell(pos, data, style, [this, &style](svg::Point min, svg::Point max) {
+                CoverBox(min, max, style.stroke_width / 2);
+            });
+            Blend(style.stroke);
+        }
+        if (style.fill.alpha > 0) {
+            ForEachGlyphCell(pos, data, style, [this](svg::Point min, svg::Point max) {
+                CoverBoxArea(min, max);
+            });
+            Blend(style.fill);
+        }
+    }
+
+    void Canvas::WritePng(ostream& out) const {
+        raster::WritePng(out, width_, height_, pixels_);
+    }
+
+    svg::Point Canvas::ToCanvas(svg::Point point) const {
+        return {point.x * scale_ - origin_.x, point.y * scale_ - origin_.y};
+    }
+
+    bool Canvas::Intersects(svg::Point min, svg::Point max) const {
+        return max.x >= 0 && max.y >= 0 && min.x <= static_cast<double>(width_) && min.y <= static_cast<double>(height_);
+    }
+
+    void Canvas::ExtendDirty(size_t x0, size_t y0, size_t x1, size_t y1) {
+        if (dirty_x0_ >= dirty_x1_ || dirty_y0_ >= dirty_y1_) {
+            dirty_x0_ = x0;
+            dirty_y0_ = y0;
+            dirty_x1_ = x1;
+            dirty_y1_ = y1;
+            return;
+        }
+        dirty_x0_ = std::min(dirty_x0_, x0);
+        dirty_y0_ = std::min(dirty_y0_, y0);
+        dirty_x1_ = std::max(dirty_x1_, x1);
+        dirty_y1_ = std::max(dirty_y1_, y1);
+    }
+
+    namespace {
+
+    // Пиксели холста, пересекающие прямоугольник [min, max]: [x0, x1) x [y0, y1)
+    struct PixelRange {
+        size_t x0 = 0;
+        size_t y0 = 0;
+        size_t x1 = 0;
+        size_t y1 = 0;
+
+        PixelRange(svg::Point min, svg::Point max, size_t width, size_t height) {
+            auto to_index = [](double value, size_t limit) {
+                return static_cast<size_t>(std::clamp(value, 0.0, static_cast<double>(limit)));
+            };
+            x0 = to_index(floor(min.x), width);
+            y0 = to_index(floor(min.y), height);
+            x1 = to_index(ceil(max.x), width);
+            y1 = to_index(ceil(max.y), height);
+        }
+
+        bool Empty() const {
+            return x0 >= x1 || y0 >= y1;
+        }
+    };
+
+    double DistanceToSegment(svg::Point point, svg::Point from, svg::Point to) {
+        const double dx = to.x - from.x;
+        const double dy = to.y - from.y;
+        const double length2 = dx * dx + dy * dy;
+        double t = 0;
+        if (length2 > 0) {
+            t = Clamp01(((point.x - from.x) * dx + (point.y - from.y) * dy) / length2);
+        }
+        return hypot(point.x - (from.x + t * dx), point.y - (from.y + t * dy));
+    }
+
+    }  // namespace
+
+    // Покрытие пикселя оценивается по расстоянию от его центра до границы фигуры:
+    // пиксели, чей центр ближе полупикселя к границе, покрываются частично
+
+    void Canvas::CoverCapsule(svg::Point from, svg::Point to, double half_width) {
+        const double extent = half_width + 1;
+        const PixelRange range({std::min(from.x, to.x) - extent, std::min(from.y, to.y) - extent},
+                               {std::max(from.x, to.x) + extent, std::max(from.y, to.y) + extent}, width_, height_);
+        if (range.Empty()) {
+            return;
+        }
+        ExtendDirty(range.x0, range.y0, range.x1, range.y1);
+        for (size_t y = range.y0; y < range.y1; ++y) {
+            for (size_t x = range.x0; x < range.x1; ++x) {
+                const double distance = DistanceToSegment({x + 0.5, y + 0.5}, from, to);
+                float& coverage = coverage_[y * width_ + x];
+                coverage = std::max(coverage, static_cast<float>(Clamp01(half_width + 0.5 - distance)));
+            }
+        }
+    }
+
+    void Canvas::CoverRing(svg::Point center, double radius, double half_width) {
+        const double extent = radius + half_width + 1;
+        const PixelRange range({center.x - extent, center.y - extent}, {center.x + extent, center.y + extent},
+                               width_, height_);
+        if (range.Empty()) {
+            return;
+        }
+        ExtendDirty(range.x0, range.y0, range.x1, range.y1);
+        for (size_t y = range.y0; y < range.y1; ++y) {
+            for (size_t x = range.x0; x < range.x1; ++x) {
+                const double distance = abs(hypot(x + 0.5 - center.x, y + 0.5 - center.y) - radius);
+                float& coverage = coverage_[y * width_ + x];
+                coverage = std::max(coverage, static_cast<float>(Clamp01(half_width + 0.5 - distance)));
+            }
+        }
+    }
+
+    void Canvas::CoverDisc(svg::Point center, double radius) {
+        const double extent = radius + 1;
+        const PixelRange range({center.x - extent, center.y - extent}, {center.x + extent, center.y + extent},
+                               width_, height_);
+        if (range.Empty()) {
+            return;
+        }
+        ExtendDirty(range.x0, range.y0, range.x1, range.y1);
+        for (size_t y = range.y0; y < range.y1; ++y) {
+            for (size_t x = range.x0; x < range.x1; ++x) {
+                const double distance = hypot(x + 0.5 - center.x, y + 0.5 - center.y);
+                float& coverage = coverage_[y * width_ + x];
+                coverage = std::max(coverage, static_cast<float>(Clamp01(radius + 0.5 - distance)));
+            }
+        }
+    }
+
+    void Canvas::CoverBox(svg::Point min, svg::Point max, double grow) {
+        const double extent = grow + 1;
+        const PixelRange range({min.x - extent, min.y - extent}, {max.x + extent, max.y + extent}, width_, height_);
+        if (range.Empty()) {
+            return;
+        }
+        ExtendDirty(range.x0, range.y0, range.x1, range.y1);
+        for (size_t y = range.y0; y < range.y1; ++y) {
+            for (size_t x = range.x0; x < range.x1; ++x) {
+                // Расстояние со знаком: внутри прямоугольника отрицательное
+                const double dx = std::max(min.x - (x + 0.5), (x + 0.5) - max.x);
+                const double dy = std::max(min.y - (y + 0.5), (y + 0.5) - max.y);
+                const double distance = hypot(std::max(dx, 0.0), std::max(dy, 0.0)) + std::min(std::max(dx, dy), 0.0);
+                float& coverage = coverage_[y * width_ + x];
+                coverage = std::max(coverage, static_cast<float>(Clamp01(grow + 0.5 - distance)));
+            }
+        }
+    }
+
+    // Точное покрытие площадью пересечения пикселя с прямоугольником. Прямоугольники
+    // одной фигуры не пересекаются, поэтому покрытия складываются без швов между ними
+    void Canvas::CoverBoxArea(svg::Point min, svg::Point max) {
+        const PixelRange range(min, max, width_, height_);
+        if (range.Empty()) {
+            return;
+        }
+        ExtendDirty(range.x0, range.y0, range.x1, range.y1);
+        for (size_t y = range.y0; y < range.y1; ++y) {
+            const double overlap_y = std::min(y + 1.0, max.y) - std::max(static_cast<double>(y), min.y);
+            for (size_t x = range.x0; x < range.x1; ++x) {
+                const double overlap_x = std::min(x + 1.0, max.x) - std::max(static_cast<double>(x), min.x);
+                float& coverage = coverage_[y * width_ + x];
+                coverage = std::min(1.0f, coverage + static_cast<float>(std::max(overlap_x, 0.0) * std::max(overlap_y, 0.0)));
+            }
+        }
+    }
+
+    // Накладывает цвет на пиксели пропорционально покрытию (source-over) и сбрасывает покрытие
+    void Canvas::Blend(Pixel color) {
+        for (size_t y = dirty_y0_; y < dirty_y1_; ++y) {
+            for (size_t x = dirty_x0_; x < dirty_x1_; ++x) {
+                float& coverage = coverage_[y * width_ + x];
+                if (coverage <= 0) {
+                    continue;
+                }
+                Pixel& pixel = pixels_[y * width_ + x];
+                const double src_alpha = color.alpha / 255.0 * coverage;
+                const double dst_alpha = pixel.alpha / 255.0 * (1 - src_alpha);
+                const double alpha = src_alpha + dst_alpha;
+                auto mix = [&](uint8_t src, uint8_t dst) {
+                    return static_cast<uint8_t>(lround((src * src_alpha + dst * dst_alpha) / alpha));
+                };
+                pixel = {mix(color.red, pixel.red), mix(color.green, pixel.green), mix(color.blue, pixel.blue),
+                         static_cast<uint8_t>(lround(alpha * 255))};
+                coverage = 0;
+            }
+        }
+        dirty_x0_ = dirty_y0_ = dirty_x1_ = dirty_y1_ = 0;
+    }
+
+    namespace {
+
+    const array<uint32_t, 256> CRC_TABLE = [] {
+        array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            table[i] = value;
+        }
+        return table;
+    }();
+
+    uint32_t Crc32(string_view data) {
+        uint32_t crc = 0xFFFFFFFFu;
+        for (unsigned char ch : data) {
+            crc = CRC_TABLE[(crc ^ ch) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    uint32_t Adler32(string_view data) {
+        uint32_t a = 1;
+        uint32_t b = 0;
+        for (unsigned char ch : data) {
+            a = (a + ch) % 65521;
+            b = (b + a) % 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    void AppendUint32(string& out, uint32_t value) {
+        out += static_cast<char>(value >> 24);
+        out += static_cast<char>(value >> 16);
+        out += static_cast<char>(value >> 8);
+        out += static_cast<char>(value);
+    }
+
+    void WriteChunk(ostream& out, string_view type, string_view data) {
+        string chunk;
+        chunk.reserve(data.size() + 12);
+        AppendUint32(chunk, static_cast<uint32_t>(data.size()));
+        chunk += type;
+        chunk += data;
+        AppendUint32(chunk, Crc32(string_view(chunk).substr(4)));
+        out.write(chunk.data(), chunk.size());
+    }
+
+    }  // namespace
+
+    void WritePng(ostream& out, size_t width, size_t height, const vector<Pixel>& pixels) {
+        out.write("\x89PNG\r\n\x1a\n", 8);
+
+        string header;
+        AppendUint32(header, static_cast<uint32_t>(width));
+        AppendUint32(header, static_cast<uint32_t>(height));
+        // 8 бит на канал, RGBA, стандартные сжатие и фильтрация, без чересстрочности
+        header += "\x08\x06\x00\x00\x00"sv;
+        WriteChunk(out, "IHDR"sv, header);
+
+        // Каждая строка начинается с типа фильтра 0 (без фильтрации)
+        string raw;
+        raw.reserve(height * (width * 4 + 1));
+        for (size_t y = 0; y < height; ++y) {
+            raw += '\0';
+            for (size_t x = 0; x < width; ++x) {
+                const Pixel& pixel = pixels[y * width + x];
+                raw += static_cast<char>(pixel.red);
+                raw += static_cast<char>(pixel.green);
+                raw += static_cast<char>(pixel.blue);
+                raw += static_cast<char>(pixel.alpha);
+            }
+        }
+
+        // Поток zlib из блоков deflate без сжатия длиной не более 65535 байт
+        static const size_t MAX_STORED_BLOCK = 65535;
+        string data = "\x78\x01"s;
+        data.reserve(raw.size() + raw.size() / MAX_STORED_BLOCK * 5 + 16);
+        size_t pos = 0;
+        do {
+            const size_t size = std::min(MAX_STORED_BLOCK, raw.size() - pos);
+            const bool last = pos + size == raw.size();
+            data += static_cast<char>(last ? 1 : 0);
+            data += static_cast<char>(size & 0xFF);
+            data += static_cast<char>(size >> 8);
+            data += static_cast<char>(~size & 0xFF);
+            data += static_cast<char>((~size >> 8) & 0xFF);
+            data.append(raw, pos, size);
+            pos += size;
+        } while (pos < raw.size());
+        AppendUint32(data, Adler32(raw));
+        WriteChunk(out, "IDAT"sv, data);
+        WriteChunk(out, "IEND"sv, {});
+    }
+
+}  // namespace raster
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+#include "svg.h"
+#include <vector>
+
+/*
+ * Программная растеризация примитивов карты в изображение RGBA без внешних библиотек.
+ * Холст принимает те же вызовы, что и svg::Writer (стили, окружности, ломаные, текст),
+ * поэтому карта выводится в него тем же кодом, что и в SVG.
+ *
+ * Упрощения по сравнению с SVG:
+ *   - ломаные рисуются только контуром с круглыми концами и соединениями, заливка не выводится;
+ *   - текст выводится встроенным растровым шрифтом 5x7 (только ASCII, прочие символы -
+ *     прямоугольником), жирное начертание утолщает знаки на одну точку шрифта;
+ *   - у текста контур рисуется под заливкой, чтобы подложка не закрывала буквы;
+ *   - из именованных цветов распознаются основные, остальные выводятся чёрным.
+ */
+
+namespace raster {
+
+    struct Pixel {
+        uint8_t red = 0;
+        uint8_t green = 0;
+        uint8_t blue = 0;
+        uint8_t alpha = 0;
+    };
+
+    // Цвет SVG в пикселе; "none" и отсутствующий цвет дают прозрачный пиксель
+    Pixel ToPixel(const svg::Color& color);
+
+    class Canvas {
+    public:
+        using StyleId = size_t;
+
+        // Холст width x height прозрачных пикселей. Точка p карты попадает в пиксель p * scale - origin,
+        // толщины линий, радиусы и размеры шрифта умножаются на scale
+        Canvas(size_t width, size_t height, double scale, svg::Point origin);
+
+        StyleId AddPathStyle(const svg::PathStyle& style);
+        StyleId AddTextStyle(const svg::TextStyle& style);
+
+        void AddCircle(svg::Point center, double radius, StyleId style);
+
+        void BeginPolyline();
+        void AddPolylinePoint(svg::Point point);
+        void EndPolyline(StyleId style);
+
+        void AddText(svg::Point pos, std::string_view data, StyleId style);
+
+        // Записывает изображение в формате PNG
+        void WritePng(std::ostream& out) const;
+
+    private:
+        struct Style {
+            Pixel fill;
+            Pixel stroke;
+            double stroke_width = 0;
+            // Только для текста
+            svg::Point offset;
+            double font_size = 0;
+            bool bold = false;
+        };
+
+        svg::Point ToCanvas(svg::Point point) const;
+        bool Intersects(svg::Point min, svg::Point max) const;
+        void CoverCapsule(svg::Point from, svg::Point to, double half_width);
+        void CoverRing(svg::Point center, double radius, double half_width);
+        void CoverDisc(svg::Point center, double radius);
+        void CoverBox(svg::Point min, svg::Point max, double grow);
+        void CoverBoxArea(svg::Point min, svg::Point max);
+        void ExtendDirty(size_t x0, size_t y0, size_t x1, size_t y1);
+        void Blend(Pixel color);
+        template <typename GlyphCell>
+        void ForEachGlyphCell(svg::Point pos, std::string_view data, const Style& style, GlyphCell cell) const;
+
+        size_t width_;
+        size_t height_;
+        double scale_;
+        svg::Point origin_;
+        std::vector<Style> styles_;
+        std::vector<Pixel> pixels_;
+        // Покрытие пикселей текущей фигурой (от 0 до 1) и прямоугольник, где оно ненулевое
+        std::vector<float> coverage_;
+        size_t dirty_x0_ = 0;
+        size_t dirty_y0_ = 0;
+        size_t dirty_x1_ = 0;
+        size_t dirty_y1_ = 0;
+        std::vector<svg::Point> polyline_;
+    };
+
+    // Записывает изображение width x height в PNG: RGBA по 8 бит, данные сжаты блоками deflate
+    // без сжатия (stored), поэтому кодировщик не зависит от zlib
+    void WritePng(std::ostream& out, size_t width, size_t height, const std::vector<Pixel>& pixels);
+
+}  // namespace raster
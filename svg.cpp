@@ -1,4 +1,7 @@
+#include <charconv>
 #include <cmath>
+#include <sstream>
+#include <stdexcept>
 #include "svg.h"
 
 namespace svg {
@@ -198,6 +201,275 @@ namespace svg {
 
     // Прочие данные и методы, необходимые для реализации элемента <text>
 
+// ---------- Writer ------------------
+
+    static void RenderPathStyle(std::ostream& out, const PathStyle& style) {
+        if (style.fill) {
+            out << " fill=\""sv << *style.fill << "\""sv;
+        }
+        if (style.stroke) {
+            out << " stroke=\""sv << *style.stroke << "\""sv;
+        }
+        if (style.width) {
+            out << " stroke-width=\""sv << *style.width << "\""sv;
+        }
+        if (style.line_cap) {
+            out << " stroke-linecap=\""sv << *style.line_cap << "\""sv;
+        }
+        if (style.line_join) {
+            out << " stroke-linejoin=\""sv << *style.line_join << "\""sv;
+        }
+    }
+
+    Writer::Writer(bool compact, int precision)
+            : compact_(compact), precision_(precision) {
+    }
+
+    // Формат совпадает с выводом double в std::ostream по умолчанию (%g, 6 знаков).
+    // В компактном режиме - фиксированная точность без завершающих нулей
+    void Writer::AppendNumber(std::string& out, double value) const {
+        char buf[64];
+        std::to_chars_result result;
+        if (!compact_) {
+            result = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::general, 6);
+        } else {
+            result = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::fixed, precision_);
+            std::string_view number(buf, result.ptr - buf);
+            if (number.find('.') != number.npos) {
+                while (number.back() == '0') {
+                    number.remove_suffix(1);
+                }
+                if (number.back() == '.') {
+                    number.remove_suffix(1);
+                }
+            }
+            if (number == "-0"sv) {
+                number = "0"sv;
+            }
+            result.ptr = buf + number.size();
+        }
+        out.append(buf, result.ptr);
+    }
+
+    void Writer::AppendPathDeclarations(std::string& out, const PathStyle& style) const {
+        std::ostringstream css;
+        if (style.fill) {
+            css << "fill:"sv << *style.fill << ";"sv;
+        }
+        if (style.stroke) {
+            css << "stroke:"sv << *style.stroke << ";"sv;
+        }
+        out += css.str();
+        if (style.width) {
+            out += "stroke-width:"sv;
+            AppendNumber(out, *style.width);
+            out += "px;"sv;
+        }
+        css.str({});
+        if (style.line_cap) {
+            css << "stroke-linecap:"sv << *style.line_cap << ";"sv;
+        }
+        if (style.line_join) {
+            css << "stroke-linejoin:"sv << *style.line_join << ";"sv;
+        }
+        out += css.str();
+    }
+
+    // Записывает класс в classes и возвращает его имя. Если имя уже занято другими объявлениями
+    // (совпадение хэшей), к нему добавляется суффикс _1, _2, ... до первого свободного или
+    // совпадающего имени. Символа '_' нет в хэш-именах, поэтому суффиксы с ними не пересекаются
+    static std::string MergeClass(std::map<std::string, std::string>& classes, const std::string& name,
+                                  const std::string& declarations) {
+        std::string candidate = name;
+        for (size_t suffix = 1;; ++suffix) {
+            const auto [it, inserted] = classes.emplace(candidate, declarations);
+            if (inserted || it->second == declarations) {
+                return candidate;
+            }
+            candidate = name + "_"s + std::to_string(suffix);
+        }
+    }
+
+    // Имя класса выводится из хэша его объявлений, поэтому одинаковые стили из разных
+    // Writer (например, частей карты, отрисованных параллельно) получают одно имя
+    Writer::StyleId Writer::AddClass(std::string declarations, std::string_view attributes) {
+        uint32_t hash = 2166136261U;
+        for (char ch : declarations) {
+            hash = (hash ^ static_cast<uint8_t>(ch)) * 16777619U;
+        }
+        std::string name = "s";
+        do {
+            name += "0123456789abcdefghijklmnopqrstuvwxyz"[hash % 36];
+            hash /= 36;
+        } while (hash != 0);
+
+        name = MergeClass(classes_, name, declarations);
+        std::string reference = " class=\""s + name + "\""s;
+        reference += attributes;
+        styles_.push_back(std::move(reference));
+        return styles_.size() - 1;
+    }
+
+    Writer::StyleId Writer::AddPathStyle(const PathStyle& style) {
+        if (compact_) {
+            std::string declarations;
+            AppendPathDeclarations(declarations, style);
+            return AddClass(std::move(declarations), {});
+        }
+        std::ostringstream out;
+        RenderPathStyle(out, style);
+        styles_.push_back(out.str());
+        return styles_.size() - 1;
+    }
+
+    Writer::StyleId Writer::AddTextStyle(const TextStyle& style) {
+        if (compact_) {
+            std::string declarations = "font-size:"s + std::to_string(style.size) + "px;"s;
+            if (!style.font_family.empty()) {
+                declarations += "font-family:"s + style.font_family + ";"s;
+            }
+            if (!style.font_weight.empty()) {
+                declarations += "font-weight:"s + style.font_weight + ";"s;
+            }
+            AppendPathDeclarations(declarations, style.path);
+            std::string offset = " dx=\""s;
+            AppendNumber(offset, style.offset.x);
+            offset += "\" dy=\""sv;
+            AppendNumber(offset, style.offset.y);
+            offset += '"';
+            return AddClass(std::move(declarations), offset);
+        }
+        std::ostringstream out;
+        out << "dx=\""sv << style.offset.x << "\" "sv << "dy=\""sv << style.offset.y << "\" "sv;
+        out << "font-size=\""sv << style.size << "\""sv;
+        if (!style.font_family.empty()) {
+            out << " font-family=\""sv << style.font_family << "\""sv;
+        }
+        if (!style.font_weight.empty()) {
+            out << " font-weight=\""sv << style.font_weight << "\""sv;
+        }
+        RenderPathStyle(out, style.path);
+        styles_.push_back(out.str());
+        return styles_.size() - 1;
+    }
+
+    void Writer::AddCircle(Point center, double radius, StyleId style) {
+        buffer_ += compact_ ? "<circle cx=\""sv : "  <circle cx=\""sv;
+        AppendNumber(buffer_, center.x);
+        buffer_ += "\" cy=\""sv;
+        AppendNumber(buffer_, center.y);
+        buffer_ += "\" r=\""sv;
+        AppendNumber(buffer_, radius);
+        buffer_ += compact_ ? "\""sv : "\" "sv;
+        buffer_ += styles_.at(style);
+        buffer_ += compact_ ? "/>"sv : "/>\n"sv;
+    }
+
+    void Writer::BeginPolyline() {
+        buffer_ += compact_ ? "<polyline points=\""sv : "  <polyline points=\""sv;
+        first_point_ = true;
+    }
+
+    void Writer::AddPolylinePoint(Point point) {
+        if (!first_point_) {
+            buffer_ += ' ';
+        }
+        first_point_ = false;
+        AppendNumber(buffer_, point.x);
+        buffer_ += ',';
+        AppendNumber(buffer_, point.y);
+    }
+
+    void Writer::EndPolyline(StyleId style) {
+        buffer_ += '"';
+        buffer_ += styles_.at(style);
+        buffer_ += compact_ ? "/>"sv : "/>\n"sv;
+    }
+
+    void Writer::AddText(Point pos, std::string_view data, StyleId style) {
+        buffer_ += compact_ ? "<text x=\""sv : "  <text x=\""sv;
+        AppendNumber(buffer_, pos.x);
+        buffer_ += "\" y=\""sv;
+        AppendNumber(buffer_, pos.y);
+        buffer_ += compact_ ? "\""sv : "\" "sv;
+        buffer_ += styles_.at(style);
+        buffer_ += '>';
+        for (char ch : data) {
+            switch (ch) {
+                case '&':
+                    buffer_ += "&amp;"sv;
+                    break;
+                case '"':
+                    buffer_ += "&quot;"sv;
+                    break;
+                case '\'':
+                    buffer_ += "&apos;"sv;
+                    break;
+                case '<':
+                    buffer_ += "&lt;"sv;
+                    break;
+                case '>':
+                    buffer_ += "&gt;"sv;
+                    break;
+                default:
+                    buffer_ += ch;
+            }
+        }
+        buffer_ += compact_ ? "</text>"sv : "</text>\n"sv;
+    }
+
+    void Writer::Append(const Writer& other) {
+        // Классы other, чьи имена здесь заняты другими объявлениями, получают новые имена
+        std::map<std::string_view, std::string> renamed;
+        for (const auto& [name, declarations] : other.classes_) {
+            std::string merged = MergeClass(classes_, name, declarations);
+            if (merged != name) {
+                renamed.emplace(name, std::move(merged));
+            }
+        }
+        if (renamed.empty()) {
+            buffer_ += other.buffer_;
+            return;
+        }
+
+        // Ссылки на переименованные классы заменяются за один проход, чтобы новое имя
+        // одного класса не было принято за старое имя другого
+        static constexpr std::string_view CLASS_PREFIX = " class=\""sv;
+        const std::string_view source = other.buffer_;
+        size_t pos = 0;
+        while (true) {
+            const size_t found = source.find(CLASS_PREFIX, pos);
+            if (found == source.npos) {
+                break;
+            }
+            const size_t name_begin = found + CLASS_PREFIX.size();
+            const size_t name_end = source.find('"', name_begin);
+            buffer_ += source.substr(pos, name_begin - pos);
+            const auto it = renamed.find(source.substr(name_begin, name_end - name_begin));
+            if (it != renamed.end()) {
+                buffer_ += it->second;
+                pos = name_end;
+            } else {
+                pos = name_begin;
+            }
+        }
+        buffer_ += source.substr(pos);
+    }
+
+    void Writer::Render(std::ostream& out) const {
+        out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv;
+        out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n"sv;
+        if (compact_ && !classes_.empty()) {
+            out << "<style>"sv;
+            for (const auto& [name, declarations] : classes_) {
+                out << '.' << name << '{' << declarations << '}';
+            }
+            out << "</style>"sv;
+        }
+        out << buffer_;
+        out << (compact_ ? "\n</svg>\n"sv : "</svg>\n"sv);
+    }
+
 }  // namespace svg
 
 
@@ -2,11 +2,14 @@
 
 #include <cstdint>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <variant>
+#include <utility>
 
 namespace svg
 {
@@ -280,6 +283,81 @@ namespace svg
         std::vector<std::unique_ptr<Object>> objects_;
     };
 
+    // Свойства контура и заливки, общие для множества фигур
+    struct PathStyle {
+        std::optional<Color> fill{};
+        std::optional<Color> stroke{};
+        std::optional<double> width{};
+        std::optional<StrokeLineCap> line_cap{};
+        std::optional<StrokeLineJoin> line_join{};
+
+        // Стиль только с заливкой, без контура
+        static PathStyle Fill(Color color) {
+            PathStyle style;
+            style.fill = std::move(color);
+            return style;
+        }
+    };
+
+    // Свойства текста, общие для множества надписей
+    struct TextStyle {
+        Point offset;
+        uint32_t size = 1;
+        std::string font_family;
+        std::string font_weight;
+        PathStyle path;
+    };
+
+/*
+ * Класс Writer выводит примитивы SVG сразу в растущий буфер, не создавая объект
+ * на каждую фигуру. Стили регистрируются один раз: их атрибуты заранее переводятся
+ * в текст и затем копируются в буфер для каждой фигуры.
+ * Результат совпадает с выводом Document для тех же фигур.
+ *
+ * В компактном режиме стили выводятся один раз в блоке <style> как CSS-классы,
+ * фигуры ссылаются на них атрибутом class, а координаты округляются до precision
+ * знаков после запятой. Изображение при этом не меняется, а размер документа
+ * уменьшается в несколько раз
+ */
+    class Writer {
+    public:
+        using StyleId = size_t;
+
+        explicit Writer(bool compact = false, int precision = 3);
+
+        StyleId AddPathStyle(const PathStyle& style);
+        StyleId AddTextStyle(const TextStyle& style);
+
+        void AddCircle(Point center, double radius, StyleId style);
+
+        // Ломаная выводится по вершинам: BeginPolyline, AddPolylinePoint..., EndPolyline
+        void BeginPolyline();
+        void AddPolylinePoint(Point point);
+        void EndPolyline(StyleId style);
+
+        void AddText(Point pos, std::string_view data, StyleId style);
+
+        // Дописывает фигуры, выведенные другим Writer, после своих.
+        // Оба Writer должны работать в одном режиме
+        void Append(const Writer& other);
+
+        // Выводит документ целиком, включая заголовок и закрывающий тег
+        void Render(std::ostream& out) const;
+
+    private:
+        void AppendNumber(std::string& out, double value) const;
+        void AppendPathDeclarations(std::string& out, const PathStyle& style) const;
+        StyleId AddClass(std::string declarations, std::string_view attributes);
+
+        bool compact_;
+        int precision_;
+        std::string buffer_;
+        std::vector<std::string> styles_;
+        // Компактный режим: имя CSS-класса -> его объявления
+        std::map<std::string, std::string> classes_;
+        bool first_point_ = true;
+    };
+
     template<typename Owner>
     void PathProps<Owner>::RenderAttrs(std::ostream& out) const {
         using namespace std::literals;
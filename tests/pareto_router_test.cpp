@@ -0,0 +1,68 @@
+// Сборка и запуск из корня репозитория:
+// g++ -std=c++17 -I. tests/pareto_router_test.cpp -o pareto_router_test && ./pareto_router_test
+
+#include "pareto_router.h"
+
+#include <cassert>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+
+constexpr graph::VertexId A = 0;
+constexpr graph::VertexId B = 1;
+constexpr graph::VertexId C = 2;
+
+// Из A в C: пешком до B и автобусом 2 от B, либо автобусом 1 до B и пересадкой на автобус 2.
+// Вес поездки на автобусе 1 задаёт, быстрее ли вариант с двумя автобусами
+graph::DirectedWeightedGraph<double> MakeGraph(double first_bus_weight) {
+    graph::DirectedWeightedGraph<double> graph(3);
+    graph.AddEdge({A, B, 5, "", "A", 0, 500, true});
+    graph.AddEdge({A, B, first_bus_weight, "1", "A", 1, 1000});
+    graph.AddEdge({B, C, 10, "2", "B", 1, 3000});
+    return graph;
+}
+
+size_t CountRides(const graph::DirectedWeightedGraph<double>& graph, const vector<graph::EdgeId>& edges) {
+    size_t rides = 0;
+    for (const graph::EdgeId edge : edges) {
+        rides += graph.GetEdge(edge).walk ? 0 : 1;
+    }
+    return rides;
+}
+
+// Пешком и автобусом - одна поездка, поэтому вариант с двумя автобусами остаётся в ответе,
+// только если он быстрее
+void TestWalkIsNotARide() {
+    {
+        const auto graph = MakeGraph(4);
+        const auto routes = graph::ParetoRouter<double>(graph).BuildRoutes(A, C);
+        assert(routes.size() == 2);
+        assert(routes[0].weight == 14 && CountRides(graph, routes[0].edges) == 2);
+        assert(routes[1].weight == 15 && CountRides(graph, routes[1].edges) == 1);
+        assert(routes[1].edges.size() == 2);
+    }
+    {
+        const auto graph = MakeGraph(5);
+        const auto routes = graph::ParetoRouter<double>(graph).BuildRoutes(A, C);
+        assert(routes.size() == 1);
+        assert(routes[0].weight == 15 && CountRides(graph, routes[0].edges) == 1);
+    }
+}
+
+// Ограничение числа поездок не мешает идти пешком
+void TestMaxRidesAllowsWalks() {
+    const auto graph = MakeGraph(4);
+    const auto routes = graph::ParetoRouter<double>(graph).BuildRoutes(A, C, nullopt, 1);
+    assert(routes.size() == 1);
+    assert(routes[0].weight == 15 && CountRides(graph, routes[0].edges) == 1);
+}
+
+}  // namespace
+
+int main() {
+    TestWalkIsNotARide();
+    TestMaxRidesAllowsWalks();
+    cout << "pareto_router_test OK"s << endl;
+}
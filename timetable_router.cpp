@@ -0,0 +1,172 @@
+#include <algorithm>
+#include "timetable_router.h"
+
+using namespace std;
+
+TimetableRouter::TimetableRouter(const map<string, Bus>& buses, size_t stop_count, const TripTimes& trip_times)
+        : stop_routes_begin_(stop_count + 1, 0)
+        , stops_(stop_count, nullptr) {
+    for (const auto& [name, bus] : buses) {
+        if ((bus.trips.empty() && bus.departures.empty()) || bus.stop_names.size() < 2) {
+            continue;
+        }
+        Route route;
+        route.bus = &bus;
+        route.stops_begin = static_cast<uint32_t>(route_stops_.size());
+        route.stop_count = static_cast<uint32_t>(bus.stop_names.size());
+        route.times_begin = static_cast<uint32_t>(times_.size());
+        route.trip_count = static_cast<uint32_t>(bus.trips.size() + bus.departures.size());
+        for (const Stop* stop : bus.stop_names) {
+            route_stops_.push_back(static_cast<uint32_t>(stop->id));
+            stops_[stop->id] = stop;
+            ++stop_routes_begin_[stop->id + 1];
+        }
+        for (const auto& trip : bus.trips) {
+            times_.insert(times_.end(), trip.begin(), trip.end());
+        }
+        // Рейсы одного автобуса с общей скоростью не обгоняют друг друга, поэтому рейсы
+        // по упорядоченным отправлениям сразу упорядочены
+        for (double departure : bus.departures) {
+            const vector<double> trip = trip_times(bus, departure);
+            times_.insert(times_.end(), trip.begin(), trip.end());
+        }
+        routes_.push_back(route);
+    }
+
+    // Маршруты остановок раскладываются подсчётом: сначала размеры, затем позиции
+    for (size_t stop = 0; stop < stop_count; ++stop) {
+        stop_routes_begin_[stop + 1] += stop_routes_begin_[stop];
+    }
+    stop_routes_.resize(stop_routes_begin_.back());
+    vector<uint32_t> filled(stop_routes_begin_.begin(), stop_routes_begin_.end() - 1);
+    for (uint32_t route = 0; route < routes_.size(); ++route) {
+        for (uint32_t position = 0; position < routes_[route].stop_count; ++position) {
+            const uint32_t stop = route_stops_[routes_[route].stops_begin + position];
+            stop_routes_[filled[stop]++] = {route, position};
+        }
+    }
+}
+
+uint32_t TimetableRouter::EarliestTrip(const Route& route, uint32_t position, double time) const {
+    uint32_t low = 0;
+    uint32_t high = route.trip_count;
+    while (low < high) {
+        const uint32_t middle = low + (high - low) / 2;
+        if (Time(route, middle, position) < time) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < route.trip_count ? low : NONE;
+}
+
+optional<TimetableRouter::Journey> TimetableRouter::BuildRoute(size_t from, size_t to, double departure_time) const {
+    const size_t stop_count = stops_.size();
+    if (from >= stop_count || to >= stop_count) {
+        return nullopt;
+    }
+
+    // labels[k][s] - самое раннее прибытие на s не более чем k рейсами,
+    // best[s] - лучшее прибытие на s за все раунды (для отсечения заведомо худших меток)
+    vector<vector<Label>> labels(1, vector<Label>(stop_count));
+    vector<double> best(stop_count, INF_TIME);
+    labels[0][from].arrival = departure_time;
+    best[from] = departure_time;
+    size_t best_round = 0;
+
+    vector<uint32_t> marked_stops{static_cast<uint32_t>(from)};
+    vector<bool> is_marked(stop_count, false);
+    vector<uint32_t> first_position(routes_.size(), NONE);
+    vector<uint32_t> queued_routes;
+
+    while (!marked_stops.empty()) {
+        // Маршрут просматривается с самой ранней отмеченной остановки
+        queued_routes.clear();
+        for (const uint32_t stop : marked_stops) {
+            is_marked[stop] = false;
+            for (uint32_t i = stop_routes_begin_[stop]; i < stop_routes_begin_[stop + 1]; ++i) {
+                const auto [route, position] = stop_routes_[i];
+                if (first_position[route] == NONE) {
+                    queued_routes.push_back(route);
+                    first_position[route] = position;
+                } else {
+                    first_position[route] = min(first_position[route], position);
+                }
+            }
+        }
+        marked_stops.clear();
+
+        const size_t round = labels.size();
+        labels.push_back(labels.back());
+        const vector<Label>& previous = labels[round - 1];
+        vector<Label>& current = labels[round];
+
+        for (const uint32_t route_id : queued_routes) {
+            const Route& route = routes_[route_id];
+            const uint32_t* route_stops = route_stops_.data() + route.stops_begin;
+            uint32_t trip = NONE;
+            uint32_t board_position = 0;
+            for (uint32_t position = first_position[route_id]; position < route.stop_count; ++position) {
+                const uint32_t stop = route_stops[position];
+                if (trip != NONE) {
+                    const double arrival = Time(route, trip, position);
+                    if (arrival < min(best[stop], best[to])) {
+                        current[stop] = {arrival, route_id, trip, board_position, position};
+                        best[stop] = arrival;
+                        if (!is_marked[stop]) {
+                            is_marked[stop] = true;
+                            marked_stops.push_back(stop);
+                        }
+                    }
+                }
+                // Пересесть на более ранний рейс можно, если сюда удалось приехать раньше его отправления
+                const double reached = previous[stop].arrival;
+                if (reached != INF_TIME && (trip == NONE || reached < Time(route, trip, position))) {
+                    const uint32_t earliest = EarliestTrip(route, position, reached);
+                    if (earliest != trip) {
+                        trip = earliest;
+                        board_position = position;
+                    }
+                }
+            }
+            first_position[route_id] = NONE;
+        }
+
+        if (current[to].arrival < labels[best_round][to].arrival) {
+            best_round = round;
+        }
+    }
+
+    if (labels[best_round][to].arrival == INF_TIME) {
+        return nullopt;
+    }
+    return MakeJourney(labels, best_round, to, departure_time);
+}
+
+TimetableRouter::Journey TimetableRouter::MakeJourney(const vector<vector<Label>>& labels, size_t round, size_t to,
+                                                      double departure_time) const {
+    Journey journey;
+    journey.departure_time = departure_time;
+    journey.arrival_time = labels[round][to].arrival;
+
+    // Метка в раунде k ссылается на остановку посадки, прибытие на которую берётся из раунда k - 1
+    size_t stop = to;
+    for (; round > 0 && labels[round][stop].route != NONE; --round) {
+        const Label& label = labels[round][stop];
+        const Route& route = routes_[label.route];
+        const uint32_t board_stop = route_stops_[route.stops_begin + label.board_position];
+        const double board_time = Time(route, label.trip, label.board_position);
+
+        Leg leg;
+        leg.board_stop = stops_[board_stop];
+        leg.bus = route.bus;
+        leg.wait_time = board_time - labels[round - 1][board_stop].arrival;
+        leg.span_count = label.alight_position - label.board_position;
+        leg.ride_time = label.arrival - board_time;
+        journey.legs.push_back(leg);
+        stop = board_stop;
+    }
+    reverse(journey.legs.begin(), journey.legs.end());
+    return journey;
+}
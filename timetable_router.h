@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include "domain.h"
+#include <functional>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+/*
+ * Поиск маршрутов по расписанию алгоритмом RAPTOR (Round-bAsed Public Transit Optimized Router).
+ * Раунд k находит самое раннее прибытие на остановки с использованием не более k рейсов,
+ * поэтому алгоритм не строит ни графа, ни таблицы расстояний между всеми парами остановок:
+ * запрос просматривает только маршруты, проходящие через остановки, улучшенные в предыдущем раунде.
+ *
+ * Данные хранятся по маршрутам в плоских массивах: остановки маршрута идут подряд,
+ * а времена каждого рейса - подряд за остановками, поэтому проход вдоль рейса читает память
+ * последовательно. Рейсы маршрута упорядочены по отправлению и не обгоняют друг друга
+ * (это проверяет справочник), что позволяет искать ближайший рейс двоичным поиском.
+ *
+ * Время - в минутах от начала суток. Пересадка на той же остановке возможна на рейс,
+ * отправляющийся не раньше момента прибытия.
+ */
+class TimetableRouter {
+public:
+    static constexpr double INF_TIME = std::numeric_limits<double>::infinity();
+
+    // Поездка одним рейсом: ожидание на остановке посадки и проезд span_count перегонов
+    struct Leg {
+        const Stop* board_stop = nullptr;
+        const Bus* bus = nullptr;
+        double wait_time = 0;
+        size_t span_count = 0;
+        double ride_time = 0;
+    };
+
+    struct Journey {
+        double departure_time = 0;
+        double arrival_time = 0;
+        std::vector<Leg> legs;
+    };
+
+    // Времена рейса автобуса, отправляющегося с первой остановки в departure
+    using TripTimes = std::function<std::vector<double>(const Bus& bus, double departure)>;
+
+    // Учитываются только автобусы, у которых задано расписание (Bus::trips или Bus::departures);
+    // рейсы по отправлениям раскладываются по остановкам функцией trip_times
+    TimetableRouter(const std::map<std::string, Bus>& buses, size_t stop_count, const TripTimes& trip_times);
+
+    // Самое раннее прибытие из from в to при отправлении не раньше departure_time.
+    // Из поездок с одинаковым временем прибытия выбирается поездка с наименьшим числом рейсов
+    std::optional<Journey> BuildRoute(size_t from, size_t to, double departure_time) const;
+
+private:
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    struct Route {
+        const Bus* bus = nullptr;
+        uint32_t stops_begin = 0;
+        uint32_t stop_count = 0;
+        uint32_t times_begin = 0;
+        uint32_t trip_count = 0;
+    };
+
+    // Маршрут и позиция остановки в нём
+    struct StopRoute {
+        uint32_t route = 0;
+        uint32_t position = 0;
+    };
+
+    // Метка остановки в раунде: время прибытия и рейс, которым оно достигнуто
+    struct Label {
+        double arrival = INF_TIME;
+        uint32_t route = NONE;
+        uint32_t trip = NONE;
+        uint32_t board_position = 0;
+        uint32_t alight_position = 0;
+    };
+
+    double Time(const Route& route, uint32_t trip, uint32_t position) const {
+        return times_[route.times_begin + trip * route.stop_count + position];
+    }
+
+    // Первый рейс, отправляющийся с позиции position не раньше time, или NONE
+    uint32_t EarliestTrip(const Route& route, uint32_t position, double time) const;
+
+    Journey MakeJourney(const std::vector<std::vector<Label>>& labels, size_t round, size_t to,
+                        double departure_time) const;
+
+    std::vector<Route> routes_;
+    std::vector<uint32_t> route_stops_;
+    std::vector<double> times_;
+    // Маршруты через каждую остановку: stop_routes_[stop_routes_begin_[s] .. stop_routes_begin_[s + 1])
+    std::vector<uint32_t> stop_routes_begin_;
+    std::vector<StopRoute> stop_routes_;
+    std::vector<const Stop*> stops_;
+};
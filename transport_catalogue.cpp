@@ -1,9 +1,13 @@
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <iomanip>
 #include <iostream>
 #include <set>
+#include <stdexcept>
 #include <string>
 #include "transport_catalogue.h"
+#include <tuple>
 
 using namespace std;
 
@@ -13,14 +17,17 @@ namespace transport::catalogue {
         stop.id = stops.size();
         stops.push_back(stop);
         stops_map[stop.name] = stops.back();
+        ++version_;
     }
 
-    std::size_t TransportCatalogue::GetId(string stop_name) {
+    std::size_t TransportCatalogue::GetId(const string& stop_name) {
         assert(stops_map.count(stop_name) > 0);
         return stops_map.at(stop_name).id;
     }
 
     void TransportCatalogue::AddBus(const Bus& bus, TransportRouter& router) {
+        Bus checked = bus;
+        CheckTrips(checked);
         for (int i = 0; i < bus.stop_names.size(); ++i) {
             auto stop = bus.stop_names.at(i);
             if (buses_stops_map.count(string(stop->name))) {
@@ -32,7 +39,7 @@ namespace transport::catalogue {
                 buses_stops_map[string(stop->name)] = buses_set;
             }
 
-            int distance = 0;
+            double distance = 0;
             int stops_count = 1;
             string prev_stop = stop->name;
             for (int j = i + 1; j < bus.stop_names.size(); ++j) {
@@ -42,18 +49,119 @@ namespace transport::catalogue {
                 } else {
                     distance += stop_distance.at({pair(next_stop->name, prev_stop)});
                 }
-                router.GetGraph().AddEdge({GetId(stop->name), GetId(next_stop->name),
-                        distance / (velocity_ * 1000 / 60) + wait_time_, bus.name, stop->name, stops_count++,
-                       distance / (velocity_ * 1000 / 60)});
+                router.AddRide({GetId(stop->name), GetId(next_stop->name), 0, bus.name, stop->name, stops_count++,
+                                distance});
                 prev_stop = next_stop->name;
             }
         }
-        buses.push_back(bus);
+        buses.push_back(move(checked));
         buses_map[bus.name] = buses.back();
+        ++version_;
+    }
+
+    void TransportCatalogue::CheckTrips(Bus& bus) {
+        if (!bus.trips.empty() && !bus.departures.empty()) {
+            throw invalid_argument("Bus " + bus.name + " has both trips and departures");
+        }
+        sort(bus.departures.begin(), bus.departures.end());
+        for (const auto& trip : bus.trips) {
+            if (trip.empty() || trip.size() != bus.stop_names.size()) {
+                throw invalid_argument("Trip of bus " + bus.name + " does not match its stops");
+            }
+            if (!is_sorted(trip.begin(), trip.end())) {
+                throw invalid_argument("Trip of bus " + bus.name + " goes back in time");
+            }
+        }
+        stable_sort(bus.trips.begin(), bus.trips.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.front() < rhs.front();
+        });
+        for (size_t i = 1; i < bus.trips.size(); ++i) {
+            for (size_t j = 0; j < bus.stop_names.size(); ++j) {
+                if (bus.trips[i][j] < bus.trips[i - 1][j]) {
+                    throw invalid_argument("Trips of bus " + bus.name + " overtake each other");
+                }
+            }
+        }
+    }
+
+    vector<NearbyStops> TransportCatalogue::FindNearbyStops(double radius) const {
+        vector<NearbyStops> result;
+        if (!(radius > 0) || stops.empty()) {
+            return result;
+        }
+
+        // Высота ячейки - radius по меридиану. Ширина берётся по самой дальней от экватора остановке,
+        // где градус долготы короче всего, чтобы близкие остановки всегда попадали в соседние ячейки.
+        // Столбцы замкнуты по кругу, поэтому остановки по разные стороны 180-го меридиана тоже соседи
+        const double lat_step = radius / geo::ComputeDistance({0, 0}, {1, 0});
+        double max_abs_lat = 0;
+        for (const Stop& stop : stops) {
+            max_abs_lat = max(max_abs_lat, abs(stop.coord.lat));
+        }
+        const double lng_scale = cos(min(max_abs_lat + lat_step, 90.0) * 3.1415926535 / 180);
+        const int64_t column_count = lng_scale > lat_step / 360 ? static_cast<int64_t>(360 * lng_scale / lat_step) : 1;
+        const double lng_step = 360.0 / column_count;
+
+        // Остановки, упорядоченные по ячейкам: (строка, столбец, номер остановки)
+        vector<tuple<int64_t, int64_t, size_t>> cells;
+        cells.reserve(stops.size());
+        for (const Stop& stop : stops) {
+            const double lng = stop.coord.lng - 360 * floor((stop.coord.lng + 180) / 360);
+            cells.emplace_back(static_cast<int64_t>(floor(stop.coord.lat / lat_step)),
+                               min(static_cast<int64_t>(floor((lng + 180) / lng_step)), column_count - 1), stop.id);
+        }
+        sort(cells.begin(), cells.end());
+
+        const int64_t neighbour_columns = min<int64_t>(column_count, 3);
+        for (const auto& [row, column, id] : cells) {
+            const Stop& stop = stops[id];
+            for (int64_t neighbour_row = row - 1; neighbour_row <= row + 1; ++neighbour_row) {
+                for (int64_t i = 0; i < neighbour_columns; ++i) {
+                    const int64_t neighbour_column = (column - 1 + i + column_count) % column_count;
+                    auto it = lower_bound(cells.begin(), cells.end(), tuple{neighbour_row, neighbour_column, size_t{0}});
+                    for (; it != cells.end() && get<0>(*it) == neighbour_row && get<1>(*it) == neighbour_column; ++it) {
+                        const Stop& other = stops[get<2>(*it)];
+                        if (other.id <= stop.id) {
+                            continue;
+                        }
+                        const double distance = geo::ComputeDistance(stop.coord, other.coord);
+                        if (distance <= radius) {
+                            result.push_back({&stop, &other, distance});
+                        }
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+    vector<double> TransportCatalogue::ComputeTripTimes(const Bus& bus, double departure, double velocity) const {
+        if (!(velocity > 0)) {
+            throw invalid_argument("Bus " + bus.name + " has departures but bus velocity is not set");
+        }
+        vector<double> times;
+        times.reserve(bus.stop_names.size());
+        double time = departure;
+        for (size_t i = 0; i < bus.stop_names.size(); ++i) {
+            if (i > 0) {
+                time += GetRoadDistance(bus.stop_names[i - 1], bus.stop_names[i]) / (velocity * 1000 / 60);
+            }
+            times.push_back(time);
+        }
+        return times;
+    }
+
+    int TransportCatalogue::GetRoadDistance(const Stop* from, const Stop* to) const {
+        const auto it = stop_distance.find({pair(from->name, to->name)});
+        if (it != stop_distance.end()) {
+            return it->second;
+        }
+        return stop_distance.at({pair(to->name, from->name)});
     }
 
     void TransportCatalogue::AddDistance(const Distance& distance) {
         stop_distance[distance.stop_pair] = distance.distance;
+        ++version_;
     }
 
     Stop* TransportCatalogue::FindStop(string_view stop_name) {
@@ -78,10 +186,49 @@ namespace transport::catalogue {
         return bus_stat;
     }
 
-    std::map<std::string, Bus> TransportCatalogue::GetRoutes() {
+    const std::map<std::string, Bus>& TransportCatalogue::GetRoutes() const {
         return buses_map;
     }
 
+    const RenderOrder& TransportCatalogue::GetRenderOrder() {
+        if (render_order_version_ != version_) {
+            BuildRenderOrder();
+            render_order_version_ = version_;
+        }
+        return render_order_;
+    }
+
+    void TransportCatalogue::BuildRenderOrder() {
+        render_order_.buses.clear();
+        render_order_.terminals.clear();
+        render_order_.stops.clear();
+
+        // Номера остановок идут подряд, поэтому обслуживаемые остановки отмечаются по номеру
+        vector<bool> served(stops.size(), false);
+        for (const auto& [name, bus] : buses_map) {
+            render_order_.buses.push_back(&bus);
+            BusTerminals terminals;
+            if (!bus.stop_names.empty()) {
+                terminals.index[terminals.count++] = 0;
+                const size_t middle = bus.stop_names.size() / 2;
+                if (!bus.round_route && bus.stop_names.size() > 1
+                    && bus.stop_names[middle]->name != bus.stop_names[0]->name) {
+                    terminals.index[terminals.count++] = middle;
+                }
+            }
+            render_order_.terminals.push_back(terminals);
+            for (const Stop* stop : bus.stop_names) {
+                if (!served[stop->id]) {
+                    served[stop->id] = true;
+                    render_order_.stops.push_back(stop);
+                }
+            }
+        }
+        sort(render_order_.stops.begin(), render_order_.stops.end(), [](const Stop* lhs, const Stop* rhs) {
+            return lhs->name < rhs->name;
+        });
+    }
+
     vector<vector<transport::geo::Coordinates>> TransportCatalogue::GetRouteCoordinates() {
         vector<vector<transport::geo::Coordinates>> routes;
         for (auto& [bus, value] : buses_map) {
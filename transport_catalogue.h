@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <deque>
 #include "domain.h"
 #include "geo.h"
@@ -18,6 +19,13 @@ namespace transport::catalogue {
         int distance;
     };
 
+    // Пара остановок и расстояние между ними по прямой в метрах
+    struct NearbyStops {
+        const Stop* first;
+        const Stop* second;
+        double distance;
+    };
+
     class DistanceHasher {
     public:
         size_t operator()(const PairStop& pair_stop) const {
@@ -29,36 +37,52 @@ namespace transport::catalogue {
     public:
         void AddStop(Stop &stop);
 
-        size_t GetId(std::string stop_name);
+        size_t GetId(const std::string& stop_name);
 
+        // Проверяет и упорядочивает расписание автобуса; при рейсе не той длины, с убывающим
+        // временем или обгоняющем другой рейс, а также при заданных вместе trips и departures
+        // бросает std::invalid_argument
         void AddBus(const Bus &bus, TransportRouter& router);
 
+        // Времена рейса, отправляющегося с первой остановки в departure: время в пути
+        // по каждому перегону вычисляется по дорожному расстоянию и скорости автобуса velocity (км/ч).
+        // При незаданной (неположительной) скорости бросает std::invalid_argument
+        std::vector<double> ComputeTripTimes(const Bus& bus, double departure, double velocity) const;
+
         void AddDistance(const Distance& distance);
 
         Stop* FindStop(std::string_view stop_name);
 
+        size_t GetStopCount() const {
+            return stops.size();
+        }
+
+        // Остановка по номеру (Stop::id)
+        const Stop& GetStop(size_t id) const {
+            return stops.at(id);
+        }
+
+        // Все пары различных остановок не дальше radius метров друг от друга, каждая пара - один раз.
+        // Остановки раскладываются по ячейкам сетки размером не меньше radius, и сравниваются
+        // только остановки из соседних ячеек, поэтому время растёт с числом близких пар, а не как V^2
+        std::vector<NearbyStops> FindNearbyStops(double radius) const;
+
         std::optional<BusStat> GetBusInfo(const std::string& bus_name) const;
 
         std::vector<std::string> GetBusesByStop(const std::string& stop_name) const;
 
         std::vector<std::vector<transport::geo::Coordinates>> GetRouteCoordinates();
 
-        std::map<std::string, Bus> GetRoutes();
-
-        void SetWait(int wait) {
-            wait_time_ = wait;
-        }
+        const std::map<std::string, Bus>& GetRoutes() const;
 
-        void SetVelocity(int velocity) {
-            velocity_ = velocity;
-        }
+        // Порядок вывода карты. Строится при первом обращении после изменения справочника
+        // и остаётся неизменным, пока справочник не изменится снова
+        const RenderOrder& GetRenderOrder();
 
-        int GetWait() {
-            return wait_time_;
-        }
-
-        double GetVelocity() {
-            return velocity_;
+        // Версия данных справочника: меняется при каждом добавлении остановки,
+        // маршрута или расстояния. Позволяет кэшировать производные данные
+        uint64_t GetVersion() const {
+            return version_;
         }
 
         std::map<int, EdgeDetails> GetEdgeMap() {
@@ -79,8 +103,13 @@ namespace transport::catalogue {
         int UniqueStops(std::vector<Stop*>) const;
         double ComputeDistanceStops(std::vector<Stop*>) const;
         double ComputeRoadDistance(std::vector<Stop*>) const;
+        int GetRoadDistance(const Stop* from, const Stop* to) const;
+        static void CheckTrips(Bus& bus);
+        void BuildRenderOrder();
+
+        RenderOrder render_order_;
+        std::optional<uint64_t> render_order_version_;
 
-        int wait_time_;
-        double velocity_;
+        uint64_t version_ = 0;
     };
 }
\ No newline at end of file
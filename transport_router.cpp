@@ -1,4 +1,22 @@
+#include <algorithm>
+#include <cmath>
+#include <queue>
 #include "transport_router.h"
+#include <utility>
+
+namespace {
+
+// Маршрут с целым весом в десятых долях секунды - маршрут с весом в минутах
+template <typename FixedRoute>
+std::optional<graph::Router<double>::RouteInfo> ToMinutes(std::optional<FixedRoute> route) {
+    if (!route) {
+        return std::nullopt;
+    }
+    return graph::Router<double>::RouteInfo{
+            static_cast<double>(route->weight) / TransportRouter::FIXED_UNITS_PER_MINUTE, std::move(route->edges)};
+}
+
+}  // namespace
 
 TransportRouter::TransportRouter() {}
 
@@ -6,15 +24,360 @@ TransportRouter::TransportRouter(const graph::DirectedWeightedGraph<double>& gra
     : router_(std::make_unique<graph::Router<double>>(graph))
 {}
 
-void TransportRouter::InitRouter() {
-    router_ = std::make_unique<graph::Router<double>>(graph_);
+void TransportRouter::SetSettings(const RoutingSettings& settings) {
+    settings_ = settings;
+}
+
+const RoutingSettings& TransportRouter::GetSettings() const {
+    return settings_;
+}
+
+void TransportRouter::SetAlgorithm(RouterAlgorithm algorithm, size_t landmark_count) {
+    algorithm_ = algorithm;
+    landmark_count_ = landmark_count;
+}
+
+void TransportRouter::SetVertexOrder(VertexOrder order) {
+    vertex_order_ = order;
+}
+
+graph::VertexId TransportRouter::ToVertex(size_t stop_id) const {
+    return stop_id < stop_vertices_.size() ? stop_vertices_[stop_id] : stop_id;
+}
+
+size_t TransportRouter::GetStopId(graph::VertexId vertex) const {
+    return vertex < vertex_stops_.size() ? vertex_stops_[vertex] : vertex;
+}
+
+void TransportRouter::AddRide(const graph::Edge<double>& ride) {
+    graph::Edge<double> edge = ride;
+    edge.from = ToVertex(ride.from);
+    edge.to = ToVertex(ride.to);
+    graph_.AddVertices(std::max(edge.from, edge.to) + 1);
+    graph_.AddEdge(edge);
+}
+
+void TransportRouter::AddWalk(graph::VertexId first_stop, graph::VertexId second_stop, double distance) {
+    const graph::VertexId first = ToVertex(first_stop);
+    const graph::VertexId second = ToVertex(second_stop);
+    graph_.AddVertices(std::max(first, second) + 1);
+    graph_.AddEdge({first, second, 0, {}, {}, 0, distance, true});
+    graph_.AddEdge({second, first, 0, {}, {}, 0, distance, true});
+}
+
+void TransportRouter::InitRouter(size_t vertex_count) {
+    graph_.AddVertices(vertex_count);
+    if (vertex_order_ == VertexOrder::CUTHILL_MCKEE) {
+        ReorderVertices();
+    }
+    for (graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+        graph_.SetEdgeWeight(edge_id, GetWeight(graph_.GetEdge(edge_id), settings_));
+    }
+
+    router_.reset();
+    alt_router_.reset();
+    fixed_router_.reset();
+    fixed_alt_router_.reset();
+    fixed_graph_ = graph::DirectedWeightedGraph<FixedWeight>(settings_.integer_weights ? graph_.GetVertexCount() : 0);
+    if (settings_.integer_weights) {
+        for (graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            fixed_graph_.AddEdge({edge.from, edge.to, GetFixedWeight(edge, settings_), {}, {}, edge.num_stops,
+                                  edge.distance, edge.walk});
+        }
+        if (algorithm_ == RouterAlgorithm::LANDMARKS) {
+            fixed_alt_router_ = std::make_unique<graph::AltRouter<FixedWeight>>(fixed_graph_, landmark_count_);
+        } else {
+            fixed_router_ = std::make_unique<graph::Router<FixedWeight>>(fixed_graph_);
+        }
+    } else if (algorithm_ == RouterAlgorithm::LANDMARKS) {
+        alt_router_ = std::make_unique<graph::AltRouter<double>>(graph_, landmark_count_);
+    } else {
+        router_ = std::make_unique<graph::Router<double>>(graph_);
+    }
+}
+
+void TransportRouter::ReorderVertices() {
+    const size_t vertex_count = graph_.GetVertexCount();
+    // Соседи вершины в обе стороны без повторов
+    std::vector<std::vector<graph::VertexId>> neighbours(vertex_count);
+    for (graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+        const auto& edge = graph_.GetEdge(edge_id);
+        if (edge.from != edge.to) {
+            neighbours[edge.from].push_back(edge.to);
+            neighbours[edge.to].push_back(edge.from);
+        }
+    }
+    for (auto& vertex_neighbours : neighbours) {
+        std::sort(vertex_neighbours.begin(), vertex_neighbours.end());
+        vertex_neighbours.erase(std::unique(vertex_neighbours.begin(), vertex_neighbours.end()), vertex_neighbours.end());
+    }
+    auto by_degree = [&neighbours](graph::VertexId lhs, graph::VertexId rhs) {
+        return neighbours[lhs].size() != neighbours[rhs].size() ? neighbours[lhs].size() < neighbours[rhs].size()
+                                                                  : lhs < rhs;
+    };
+
+    // Обход в ширину каждой компоненты от вершины наименьшей степени; соседи - по возрастанию степени
+    std::vector<graph::VertexId> starts(vertex_count);
+    for (graph::VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        starts[vertex] = vertex;
+    }
+    std::sort(starts.begin(), starts.end(), by_degree);
+    std::vector<graph::VertexId> order;
+    order.reserve(vertex_count);
+    std::vector<bool> visited(vertex_count, false);
+    std::vector<graph::VertexId> next;
+    for (const graph::VertexId start : starts) {
+        if (visited[start]) {
+            continue;
+        }
+        visited[start] = true;
+        order.push_back(start);
+        for (size_t i = order.size() - 1; i < order.size(); ++i) {
+            next.clear();
+            for (const graph::VertexId neighbour : neighbours[order[i]]) {
+                if (!visited[neighbour]) {
+                    visited[neighbour] = true;
+                    next.push_back(neighbour);
+                }
+            }
+            std::sort(next.begin(), next.end(), by_degree);
+            order.insert(order.end(), next.begin(), next.end());
+        }
+    }
+    std::reverse(order.begin(), order.end());
+
+    // Рёбра раскладываются подряд по новым номерам начальных вершин
+    std::vector<graph::VertexId> position(vertex_count);
+    for (graph::VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        position[order[vertex]] = vertex;
+    }
+    graph::DirectedWeightedGraph<double> ordered(vertex_count);
+    for (const graph::VertexId vertex : order) {
+        for (const graph::EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+            graph::Edge<double> edge = graph_.GetEdge(edge_id);
+            edge.from = position[edge.from];
+            edge.to = position[edge.to];
+            ordered.AddEdge(edge);
+        }
+    }
+    graph_ = std::move(ordered);
+
+    // Перенумерация применяется поверх предыдущей
+    for (size_t stop = stop_vertices_.size(); stop < vertex_count; ++stop) {
+        stop_vertices_.push_back(stop);
+    }
+    vertex_stops_.assign(vertex_count, 0);
+    for (size_t stop = 0; stop < vertex_count; ++stop) {
+        stop_vertices_[stop] = position[stop_vertices_[stop]];
+        vertex_stops_[stop_vertices_[stop]] = stop;
+    }
 }
 
-graph::DirectedWeightedGraph<double>& TransportRouter::GetGraph() {
+const graph::DirectedWeightedGraph<double>& TransportRouter::GetGraph() const {
     return graph_;
 }
 
-std::optional<graph::Router<double>::RouteInfo> TransportRouter::BuildRoute(graph::VertexId from, graph::VertexId to) {
+double TransportRouter::GetRideTime(const graph::Edge<double>& edge, const RoutingSettings& settings) {
+    const double speed = edge.walk ? settings.walking_speed : settings.bus_velocity;
+    const double time = edge.distance / (speed * 1000 / 60);
+    if (settings.integer_weights) {
+        return std::round(time * FIXED_UNITS_PER_MINUTE) / FIXED_UNITS_PER_MINUTE;
+    }
+    return time;
+}
+
+double TransportRouter::GetWeight(const graph::Edge<double>& edge, const RoutingSettings& settings) {
+    if (settings.integer_weights) {
+        return static_cast<double>(GetFixedWeight(edge, settings)) / FIXED_UNITS_PER_MINUTE;
+    }
+    if (edge.walk) {
+        return GetRideTime(edge, settings);
+    }
+    return GetRideTime(edge, settings) + settings.bus_wait_time;
+}
+
+TransportRouter::FixedWeight TransportRouter::GetFixedWeight(const graph::Edge<double>& edge,
+                                                             const RoutingSettings& settings) {
+    const double speed = edge.walk ? settings.walking_speed : settings.bus_velocity;
+    const auto ride_time = static_cast<FixedWeight>(std::llround(edge.distance / (speed * 1000 / 60) * FIXED_UNITS_PER_MINUTE));
+    if (edge.walk) {
+        return ride_time;
+    }
+    return ride_time + static_cast<FixedWeight>(settings.bus_wait_time) * FIXED_UNITS_PER_MINUTE;
+}
+
+std::optional<graph::Router<double>::RouteInfo> TransportRouter::BuildRoute(graph::VertexId from_stop,
+                                                                            graph::VertexId to_stop) {
+    const graph::VertexId from = ToVertex(from_stop);
+    const graph::VertexId to = ToVertex(to_stop);
+    if (fixed_alt_router_) {
+        return ToMinutes(fixed_alt_router_->BuildRoute(from, to));
+    }
+    if (fixed_router_) {
+        return ToMinutes(fixed_router_->BuildRoute(from, to));
+    }
+    if (alt_router_) {
+        auto route = alt_router_->BuildRoute(from, to);
+        if (!route) {
+            return std::nullopt;
+        }
+        return graph::Router<double>::RouteInfo{route->weight, std::move(route->edges)};
+    }
     return router_->BuildRoute(from, to);
 }
 
+std::optional<graph::Router<double>::RouteInfo> TransportRouter::BuildRoute(graph::VertexId from, graph::VertexId to,
+                                                                            const RoutingSettings& settings) {
+    if (settings == settings_) {
+        return BuildRoute(from, to);
+    }
+
+    // Дейкстра по тому же графу с весами, вычисляемыми из настроек запроса
+    return GetTreeRoute(BuildRouteTree(from, false, settings, {to}), to);
+}
+
+bool TransportRouter::SearchesPerRoute(const RoutingSettings& settings) const {
+    return alt_router_ || fixed_alt_router_ || settings != settings_;
+}
+
+template <typename Weight, typename Queue, typename EdgeWeight>
+std::vector<std::optional<Weight>> TransportRouter::SearchRouteTree(graph::VertexId root, bool reverse,
+                                                                    const std::vector<graph::VertexId>& targets,
+                                                                    EdgeWeight edge_weight,
+                                                                    std::vector<graph::EdgeId>& tree_edge) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    std::vector<std::optional<Weight>> distance(vertex_count);
+    std::vector<bool> is_target(vertex_count, false);
+    size_t remaining = 0;
+    for (const graph::VertexId target : targets) {
+        if (!is_target.at(target)) {
+            is_target[target] = true;
+            ++remaining;
+        }
+    }
+
+    Queue queue;
+    distance.at(root) = Weight{};
+    queue.push({Weight{}, root});
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > *distance[vertex]) {
+            continue;
+        }
+        if (is_target[vertex] && --remaining == 0) {
+            break;
+        }
+        for (const graph::EdgeId edge_id : reverse ? graph_.GetIncomingEdges(vertex) : graph_.GetIncidentEdges(vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const graph::VertexId next = reverse ? edge.from : edge.to;
+            const Weight candidate = weight + edge_weight(edge);
+            if (!distance[next] || candidate < *distance[next]) {
+                distance[next] = candidate;
+                tree_edge[next] = edge_id;
+                queue.push({candidate, next});
+            }
+        }
+    }
+    return distance;
+}
+
+TransportRouter::RouteTree TransportRouter::BuildRouteTree(graph::VertexId root_stop, bool reverse,
+                                                           const RoutingSettings& settings,
+                                                           const std::vector<graph::VertexId>& target_stops) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    const graph::VertexId root = ToVertex(root_stop);
+    std::vector<graph::VertexId> targets;
+    targets.reserve(target_stops.size());
+    for (const graph::VertexId stop : target_stops) {
+        targets.push_back(ToVertex(stop));
+    }
+    RouteTree tree{root, reverse, std::vector<double>(vertex_count, -1),
+                   std::vector<graph::EdgeId>(vertex_count, graph_.GetEdgeCount())};
+    if (settings.integer_weights) {
+        // Целые веса не убывают вдоль поиска, поэтому подходит монотонная очередь без сравнений
+        const auto distance = SearchRouteTree<FixedWeight, graph::RadixHeap<FixedWeight, graph::VertexId>>(
+                root, reverse, targets, [&settings](const auto& edge) {
+                    return GetFixedWeight(edge, settings);
+                }, tree.edge);
+        for (graph::VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            if (distance[vertex]) {
+                tree.distance[vertex] = static_cast<double>(*distance[vertex]) / FIXED_UNITS_PER_MINUTE;
+            }
+        }
+    } else {
+        using Item = std::pair<double, graph::VertexId>;
+        const auto distance = SearchRouteTree<double, std::priority_queue<Item, std::vector<Item>, std::greater<>>>(
+                root, reverse, targets, [&settings](const auto& edge) {
+                    return GetWeight(edge, settings);
+                }, tree.edge);
+        for (graph::VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            if (distance[vertex]) {
+                tree.distance[vertex] = *distance[vertex];
+            }
+        }
+    }
+    return tree;
+}
+
+std::optional<graph::Router<double>::RouteInfo> TransportRouter::GetTreeRoute(const RouteTree& tree,
+                                                                              graph::VertexId other_stop) const {
+    const graph::VertexId other = ToVertex(other_stop);
+    if (tree.distance.at(other) < 0) {
+        return std::nullopt;
+    }
+    std::vector<graph::EdgeId> edges;
+    for (graph::VertexId vertex = other; vertex != tree.root;) {
+        const auto& edge = graph_.GetEdge(tree.edge[vertex]);
+        edges.push_back(tree.edge[vertex]);
+        vertex = tree.reverse ? edge.to : edge.from;
+    }
+    if (!tree.reverse) {
+        std::reverse(edges.begin(), edges.end());
+    }
+    return graph::Router<double>::RouteInfo{tree.distance[other], std::move(edges)};
+}
+
+TransportRouter::SettingsEdgeWeight TransportRouter::MakeEdgeWeight(const RoutingSettings& settings) const {
+    return {settings == settings_ ? nullptr : &settings};
+}
+
+std::vector<graph::ParetoRouter<double, TransportRouter::SettingsEdgeWeight>::RouteInfo> TransportRouter::BuildParetoRoutes(
+        graph::VertexId from, graph::VertexId to, const RoutingSettings& settings,
+        std::optional<double> max_extra_time) const {
+    return graph::ParetoRouter<double, SettingsEdgeWeight>(graph_, MakeEdgeWeight(settings))
+            .BuildRoutes(ToVertex(from), ToVertex(to), max_extra_time);
+}
+
+std::vector<graph::KShortestRouter<double, TransportRouter::SettingsEdgeWeight>::RouteInfo>
+TransportRouter::BuildAlternativeRoutes(graph::VertexId from, graph::VertexId to, const RoutingSettings& settings,
+                                        size_t count, double max_similarity) const {
+    return graph::KShortestRouter<double, SettingsEdgeWeight>(graph_, MakeEdgeWeight(settings))
+            .BuildRoutes(ToVertex(from), ToVertex(to), count, max_similarity);
+}
+
+std::vector<std::optional<double>> TransportRouter::BuildMatrix(const std::vector<graph::VertexId>& source_stops,
+                                                                const std::vector<graph::VertexId>& target_stops) const {
+    std::vector<graph::VertexId> sources;
+    sources.reserve(source_stops.size());
+    for (const graph::VertexId stop : source_stops) {
+        sources.push_back(ToVertex(stop));
+    }
+    std::vector<graph::VertexId> targets;
+    targets.reserve(target_stops.size());
+    for (const graph::VertexId stop : target_stops) {
+        targets.push_back(ToVertex(stop));
+    }
+    if (!settings_.integer_weights) {
+        return graph::ManyToManyRouter<double>(graph_).BuildMatrix(sources, targets);
+    }
+    const auto fixed_matrix = graph::ManyToManyRouter<FixedWeight>(fixed_graph_).BuildMatrix(sources, targets);
+    std::vector<std::optional<double>> matrix(fixed_matrix.size());
+    for (size_t i = 0; i < matrix.size(); ++i) {
+        if (fixed_matrix[i]) {
+            matrix[i] = static_cast<double>(*fixed_matrix[i]) / FIXED_UNITS_PER_MINUTE;
+        }
+    }
+    return matrix;
+}
@@ -1,21 +1,183 @@
+#pragma once
+
+#include "alt_router.h"
+#include <cstdint>
 #include "graph.h"
+#include "k_shortest_router.h"
+#include "many_to_many_router.h"
 #include <memory>
+#include <optional>
+#include "pareto_router.h"
+#include "radix_heap.h"
 #include "router.h"
+#include <vector>
+
+// Способ поиска кратчайшего маршрута: таблица маршрутов между всеми парами остановок (память V x V)
+// или двунаправленный A* с ориентирами (память ориентиры x V, без таблицы)
+enum class RouterAlgorithm {
+    TABLE,
+    LANDMARKS,
+};
+
+// Нумерация вершин графа: в порядке добавления остановок или обратным алгоритмом Катхилла - Макки,
+// при котором соседние в сети остановки получают близкие номера и поиски реже промахиваются мимо кэша
+enum class VertexOrder {
+    INPUT,
+    CUTHILL_MCKEE,
+};
+
+// Время ожидания автобуса на остановке в минутах и скорость автобуса в км/ч. Если заданы
+// walking_radius (м) и walking_speed (км/ч), остановки не дальше walking_radius друг от друга
+// соединяются переходами пешком. При integer_weights время каждого ребра округляется до десятых
+// долей секунды, и поиск идёт по целым весам: сравнения быстрее, а результат не зависит
+// от порядка сложения
+struct RoutingSettings {
+    int bus_wait_time = 0;
+    double bus_velocity = 0;
+    double walking_speed = 0;
+    double walking_radius = 0;
+    bool integer_weights = false;
 
-static int BUS_STOPS_MAX = 100;
+    bool operator==(const RoutingSettings& other) const {
+        return bus_wait_time == other.bus_wait_time && bus_velocity == other.bus_velocity
+               && walking_speed == other.walking_speed && walking_radius == other.walking_radius
+               && integer_weights == other.integer_weights;
+    }
 
+    bool operator!=(const RoutingSettings& other) const {
+        return !(*this == other);
+    }
+};
+
+/**
+ * Рёбра графа хранят исходные данные поездки - расстояние и число перегонов, а вес
+ * (время в пути плюс ожидание) вычисляется из настроек в InitRouter. Поэтому настройки можно
+ * задавать после добавления маршрутов и менять без повторного добавления рёбер, а маршрут
+ * при других настройках для одного запроса строится поиском по тому же графу.
+ *
+ * Методы принимают номера остановок. Номера вершин графа совпадают с ними, пока InitRouter
+ * не перенумерует вершины (SetVertexOrder); концы рёбер GetGraph() - номера вершин,
+ * и GetStopId переводит их обратно в номера остановок.
+ */
 class TransportRouter {
 public:
     TransportRouter();
     TransportRouter(const graph::DirectedWeightedGraph<double>& graph);
 
-    void InitRouter();
+    // Настройки и способ поиска действуют со следующего вызова InitRouter
+    void SetSettings(const RoutingSettings& settings);
+    const RoutingSettings& GetSettings() const;
+    void SetAlgorithm(RouterAlgorithm algorithm, size_t landmark_count = DEFAULT_LANDMARK_COUNT);
+    void SetVertexOrder(VertexOrder order);
+
+    // Поездка одним автобусом от остановки ride.from до ride.to; вес ребра задавать не нужно
+    void AddRide(const graph::Edge<double>& ride);
+
+    // Переход пешком на distance метров в обе стороны между остановками first и second
+    void AddWalk(graph::VertexId first, graph::VertexId second, double distance);
 
-    graph::DirectedWeightedGraph<double>& GetGraph();
+    // Вычисляет веса рёбер по текущим настройкам и готовит поиск маршрутов.
+    // Вершины графа - номера остановок, vertex_count - число остановок
+    void InitRouter(size_t vertex_count);
+
+    const graph::DirectedWeightedGraph<double>& GetGraph() const;
+
+    // Номер остановки вершины графа
+    size_t GetStopId(graph::VertexId vertex) const;
 
     std::optional<graph::Router<double>::RouteInfo> BuildRoute(graph::VertexId from, graph::VertexId to);
 
+    // Маршрут при других настройках: веса рёбер вычисляются во время поиска, граф и таблица не перестраиваются
+    std::optional<graph::Router<double>::RouteInfo> BuildRoute(graph::VertexId from, graph::VertexId to,
+                                                               const RoutingSettings& settings);
+
+    // Ищет ли BuildRoute с такими настройками маршрут отдельным поиском, а не берёт из таблицы.
+    // Только тогда запросам с общим началом или концом выгодно одно общее дерево маршрутов
+    bool SearchesPerRoute(const RoutingSettings& settings) const;
+
+    // Кратчайшие маршруты из root во все вершины (reverse == false) или из всех вершин в root
+    // (reverse == true). Массивы - по вершинам графа: distance[v] < 0 - маршрута нет;
+    // edge[v] - ребро маршрута, ближайшее к v
+    struct RouteTree {
+        graph::VertexId root = 0;
+        bool reverse = false;
+        std::vector<double> distance;
+        std::vector<graph::EdgeId> edge;
+    };
+
+    // Поиск останавливается, как только найдены маршруты до всех вершин targets
+    RouteTree BuildRouteTree(graph::VertexId root, bool reverse, const RoutingSettings& settings,
+                             const std::vector<graph::VertexId>& targets) const;
+
+    // Маршрут между корнем дерева и вершиной other, в порядке проезда
+    std::optional<graph::Router<double>::RouteInfo> GetTreeRoute(const RouteTree& tree, graph::VertexId other) const;
+
+    // Вес ребра для поиска по Парето и альтернативных маршрутов: без settings - хранящийся в графе
+    // (по текущим настройкам), иначе вычисленный из settings
+    struct SettingsEdgeWeight {
+        const RoutingSettings* settings = nullptr;
+
+        double operator()(const graph::Edge<double>& edge) const {
+            return settings ? GetWeight(edge, *settings) : edge.weight;
+        }
+    };
+
+    // Маршруты, недоминируемые по времени и числу поездок, не дольше самого быстрого более чем на max_extra_time.
+    // Веса рёбер вычисляются из settings по ходу поиска, граф не копируется
+    std::vector<graph::ParetoRouter<double, SettingsEdgeWeight>::RouteInfo> BuildParetoRoutes(
+            graph::VertexId from, graph::VertexId to, const RoutingSettings& settings,
+            std::optional<double> max_extra_time) const;
+
+    // До count маршрутов в порядке возрастания времени, похожих друг на друга не больше чем на max_similarity.
+    // Настройки settings учитываются так же, как в BuildParetoRoutes
+    std::vector<graph::KShortestRouter<double, SettingsEdgeWeight>::RouteInfo> BuildAlternativeRoutes(
+            graph::VertexId from, graph::VertexId to, const RoutingSettings& settings,
+            size_t count, double max_similarity) const;
+
+    // Время маршрутов из каждой остановки sources в каждую остановку targets по строкам, nullopt - маршрута нет
+    std::vector<std::optional<double>> BuildMatrix(const std::vector<graph::VertexId>& sources,
+                                                   const std::vector<graph::VertexId>& targets) const;
+
+    // Целый вес - время в десятых долях секунды
+    using FixedWeight = uint64_t;
+    static constexpr FixedWeight FIXED_UNITS_PER_MINUTE = 600;
+
+    // Время в пути по ребру (на автобусе или пешком) и вес ребра - время в пути плюс ожидание автобуса
+    static double GetRideTime(const graph::Edge<double>& edge, const RoutingSettings& settings);
+    static double GetWeight(const graph::Edge<double>& edge, const RoutingSettings& settings);
+    static FixedWeight GetFixedWeight(const graph::Edge<double>& edge, const RoutingSettings& settings);
+
+    static constexpr size_t DEFAULT_LANDMARK_COUNT = 8;
+
 private:
+    // Вершина графа остановки
+    graph::VertexId ToVertex(size_t stop_id) const;
+
+    // Перенумеровывает вершины в обратном порядке Катхилла - Макки и раскладывает рёбра по вершинам
+    void ReorderVertices();
+
+    // Вес хранящийся в графе, если settings совпадают с текущими, иначе вычисляемый из settings
+    SettingsEdgeWeight MakeEdgeWeight(const RoutingSettings& settings) const;
+
+    // Поиск Дейкстры для BuildRouteTree с весами рёбер edge_weight(edge) типа Weight
+    template <typename Weight, typename Queue, typename EdgeWeight>
+    std::vector<std::optional<Weight>> SearchRouteTree(graph::VertexId root, bool reverse,
+                                                       const std::vector<graph::VertexId>& targets,
+                                                       EdgeWeight edge_weight, std::vector<graph::EdgeId>& tree_edge) const;
+
+    RoutingSettings settings_;
+    RouterAlgorithm algorithm_ = RouterAlgorithm::TABLE;
+    size_t landmark_count_ = DEFAULT_LANDMARK_COUNT;
+    VertexOrder vertex_order_ = VertexOrder::INPUT;
+    // Вершина каждой остановки и остановка каждой вершины; пустые - номера совпадают
+    std::vector<graph::VertexId> stop_vertices_;
+    std::vector<size_t> vertex_stops_;
     std::unique_ptr<graph::Router<double>> router_;
-    graph::DirectedWeightedGraph<double> graph_ = graph::DirectedWeightedGraph<double>(BUS_STOPS_MAX);
-};
\ No newline at end of file
+    std::unique_ptr<graph::AltRouter<double>> alt_router_;
+    graph::DirectedWeightedGraph<double> graph_;
+    // При integer_weights: копия графа с целыми весами и теми же номерами рёбер (без названий)
+    // и поиск кратчайших маршрутов по ней
+    graph::DirectedWeightedGraph<FixedWeight> fixed_graph_;
+    std::unique_ptr<graph::Router<FixedWeight>> fixed_router_;
+    std::unique_ptr<graph::AltRouter<FixedWeight>> fixed_alt_router_;
+};